@@ -51,6 +51,7 @@
 #include "engines/darkseed2/font.h"
 #include "engines/darkseed2/script.h"
 #include "engines/darkseed2/imageconverter.h"
+#include "engines/darkseed2/spritecache.h"
 #include "engines/darkseed2/graphics.h"
 #include "engines/darkseed2/room.h"
 #include "engines/darkseed2/conversationbox.h"
@@ -87,6 +88,7 @@ DarkSeed2Engine::DarkSeed2Engine(OSystem *syst, const DS2GameDescription *gameDe
 	DebugMan.addDebugChannel(kDebugOpcodes     , "Opcodes"     , "Script functions debug level");
 	DebugMan.addDebugChannel(kDebugRoomConf    , "RoomConf"    , "Room config debug level");
 	DebugMan.addDebugChannel(kDebugGameflow    , "Gameflow"    , "Gameflow debug level");
+	DebugMan.addDebugChannel(kDebugRefBlit     , "RefBlit"     , "Check sprite blits against the slow reference code");
 
 	// Setup mixer
 	_mixer->setVolumeForSoundType(Audio::Mixer::kMusicSoundType, ConfMan.getInt("music_volume"));
@@ -143,6 +145,8 @@ DarkSeed2Engine::~DarkSeed2Engine() {
 	delete _rnd;
 
 	delete _macExeResFork;
+
+	SprCache.clear();
 }
 
 Common::Error DarkSeed2Engine::run() {
@@ -250,6 +254,9 @@ bool DarkSeed2Engine::init(int32 width, int32 height) {
 
 	debug(-1, "Indexing resources...");
 
+	_resources->setMapArchives(_options->getMapArchives());
+	_resources->setIndexCache(_targetName + ".idx");
+
 	if (isSaturn()) {
 		if (!_resources->indexPGF()) {
 			warning("DarkSeed2Engine::init(): Couldn't index resources");
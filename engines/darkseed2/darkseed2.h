@@ -54,7 +54,8 @@ enum {
 	kDebugConversation = 1 <<  9,
 	kDebugOpcodes      = 1 << 10,
 	kDebugRoomConf     = 1 << 11,
-	kDebugGameflow     = 1 << 12
+	kDebugGameflow     = 1 << 12,
+	kDebugRefBlit      = 1 << 13
 };
 
 struct DS2GameDescription;
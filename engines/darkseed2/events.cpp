@@ -153,10 +153,10 @@ bool Events::introSequence() {
 			return true;
 
 		// Loading title parts, for hotspot detection
-		_titleSprites[0].loadFromImage(*_vm->_resources, "002BTN01");
-		_titleSprites[1].loadFromImage(*_vm->_resources, "002BTN02");
-		_titleSprites[2].loadFromImage(*_vm->_resources, "002BTN03");
-		_titleSprites[3].loadFromImage(*_vm->_resources, "002BTN04");
+		_titleSprites[0].loadFromImage(*_vm->_resources, "002BTN01", true);
+		_titleSprites[1].loadFromImage(*_vm->_resources, "002BTN02", true);
+		_titleSprites[2].loadFromImage(*_vm->_resources, "002BTN03", true);
+		_titleSprites[3].loadFromImage(*_vm->_resources, "002BTN04", true);
 
 		for (int i = 0; i < 4; i++) {
 			if (_titleSprites[i].empty()) {
@@ -301,6 +301,10 @@ void Events::mainLoop(bool finishScripts) {
 
 		_vm->_mike->updateStatus();
 
+		// Use the idle time to read the rooms we might go to next
+		if (!_changeRoom && isIdle())
+			_vm->_graphics->getRoom().prefetch(*_vm->_resources);
+
 		// Update screen
 		_vm->_graphics->retrace();
 		g_system->updateScreen();
@@ -310,6 +314,21 @@ void Events::mainLoop(bool finishScripts) {
 	}
 }
 
+bool Events::isIdle() const {
+	if (_vm->_inter->hasScripts())
+		return false;
+	if (_vm->_movie->isPlaying())
+		return false;
+	if (_vm->_graphics->getConversationBox().isActive())
+		return false;
+	if (_vm->_talkMan->isTalking())
+		return false;
+	if (_vm->_mike->isBusy())
+		return false;
+
+	return true;
+}
+
 void Events::handleInput() {
 	Common::Event event;
 
@@ -128,6 +128,9 @@ private:
 	/** Start the game's main loop. */
 	void mainLoop(bool finishScripts = false);
 
+	/** Is nothing going on that reading ahead could hold up? */
+	bool isIdle() const;
+
 	/** Handle user input. */
 	void handleInput();
 
@@ -215,13 +215,18 @@ const Sprite &SpriteObject::getSprite() const {
 	return *_sprite;
 }
 
-bool SpriteObject::loadFromImage(Resources &resources, const Common::String &image) {
+bool SpriteObject::loadFromImage(Resources &resources, const Common::String &image, bool shared) {
 	clear();
 
 	_sprite = new Sprite;
 
-	if (!_sprite->loadFromImage(resources, image))
-		return false;
+	if (shared) {
+		if (!_sprite->loadShared(resources, image))
+			return false;
+	} else {
+		if (!_sprite->loadFromImage(resources, image))
+			return false;
+	}
 
 	_area = _sprite->getArea();
 	_area.moveTo(_sprite->getDefaultX(), _sprite->getDefaultY());
@@ -355,14 +360,7 @@ bool Animation::load(Resources &resources, const Common::String &base) {
 	const VersionFormats &formats = resources.getVersionFormats();
 
 	// Find the frame with the biggest number that still exists
-	uint8 count = 0;
-	for (int i = 99; i > 0; i--) {
-		if (resources.hasResource(Resources::addExtension(base + Common::String::format("%02d", i),
-						formats.getImageExtension(formats.getImageType())))) {
-			count = i;
-			break;
-		}
-	}
+	uint8 count = resources.getFrameCount(base, formats.getImageExtension(formats.getImageType()));
 
 	// None found
 	if (count == 0) {
@@ -375,7 +373,7 @@ bool Animation::load(Resources &resources, const Common::String &base) {
 
 		// Load it
 		SpriteObject *object = new SpriteObject;
-		if (!object->loadFromImage(resources, base)) {
+		if (!object->loadFromImage(resources, base, true)) {
 			warning("Animation::load(): Failed loading sprite \"%s\"", base.c_str());
 			delete object;
 			return false;
@@ -393,7 +391,7 @@ bool Animation::load(Resources &resources, const Common::String &base) {
 		Common::String bmp = base + Common::String::format("%02d", i + 1);
 
 		SpriteObject *object = new SpriteObject;
-		if (!object->loadFromImage(resources, bmp)) {
+		if (!object->loadFromImage(resources, bmp, true)) {
 			// Frame doesn't exist
 
 			// If it's the first one, take the newly created empty one.
@@ -417,6 +415,16 @@ bool Animation::load(Resources &resources, const Common::String &base) {
 	return true;
 }
 
+uint32 Animation::getMemorySize() const {
+	uint32 size = 0;
+
+	for (Common::Array<SpriteObject *>::const_iterator sprite = _sprites.begin(); sprite != _sprites.end(); ++sprite)
+		if (!(*sprite)->empty())
+			size += (*sprite)->getSprite().getMemorySize();
+
+	return size;
+}
+
 void Animation::flipHorizontally() {
 	for (Common::Array<SpriteObject *>::iterator sprite = _sprites.begin(); sprite != _sprites.end(); ++sprite)
 		(*sprite)->getSprite().flipHorizontally();
@@ -131,8 +131,8 @@ public:
 	/** Return the sprite. */
 	const Sprite &getSprite() const;
 
-	/** Load the sprite from a BMP. */
-	bool loadFromImage(Resources &resources, const Common::String &image);
+	/** Load the sprite from a BMP, optionally sharing it with everything else showing the same image. */
+	bool loadFromImage(Resources &resources, const Common::String &image, bool shared = false);
 
 	/** Redraw the object. */
 	void redraw(Sprite &sprite, Common::Rect area);
@@ -196,6 +196,9 @@ public:
 	/** Load the animation from files. */
 	bool load(Resources &resources, const Common::String &base);
 
+	/** Return the amount of memory currently held by the animation's sprites. */
+	uint32 getMemorySize() const;
+
 	/** Flip the animation's sprites horizontally. */
 	void flipHorizontally();
 	/** Flip the animation's sprites vertically. */
@@ -41,6 +41,12 @@
 
 namespace DarkSeed2 {
 
+/** Number of separate dirty rectangles before we just redraw the whole screen. */
+static const uint kMaxDirtyRects = 64;
+
+/** Height of the screen bands sprites are sorted into for culling. */
+static const int kSpriteBandHeight = 32;
+
 Graphics::SpriteQueueEntry::SpriteQueueEntry() {
 	anim       = 0;
 	object     = 0;
@@ -119,6 +125,8 @@ Graphics::Graphics(int32 width, int32 height, Resources &resources,
 
 	_screen.create(_screenWidth, _screenHeight);
 
+	_spriteBands.resize((_screenHeight + kSpriteBandHeight - 1) / kSpriteBandHeight);
+
 	_dirtyAll = false;
 
 	_background = 0;
@@ -349,31 +357,44 @@ void Graphics::dirtyRectsAdd(const Common::Rect &rect) {
 	if (_dirtyAll)
 		return;
 
-	if ((rect.left == 0) && (rect.top == 0) &&
-	    (rect.right >= ((int) _screenWidth)) && (rect.bottom >= ((int) _screenHeight))) {
+	Common::Rect area = rect;
 
-		dirtyAll();
+	area.clip(Common::Rect(0, 0, _screenWidth, _screenHeight));
+	if (area.isEmpty())
 		return;
-	}
 
-	// Upper limit. Dirty rectangle overhead isn't that great either :P
-	if (_dirtyRects.size() >= 30) {
+	if ((area.left == 0) && (area.top == 0) &&
+	    (area.right >= ((int) _screenWidth)) && (area.bottom >= ((int) _screenHeight))) {
+
 		dirtyAll();
 		return;
 	}
 
-/*
-	// If the rectangle intersects with an already existing one, merge them
-	for (Common::List<Common::Rect>::iterator it = _dirtyRects.begin(); it != _dirtyRects.end(); ++it) {
-		if(it->intersects(rect)) {
-			it->extend(rect);
+	// Merge the rectangle with every one it overlaps, so that the dirty
+	// rectangles never overlap and no pixel is redrawn twice per frame
+	Common::List<Common::Rect>::iterator it = _dirtyRects.begin();
+	while (it != _dirtyRects.end()) {
+		if (it->contains(area))
+			// Already completely dirty
 			return;
+
+		if (it->intersects(area)) {
+			area.extend(*it);
+			_dirtyRects.erase(it);
+
+			// The merged rectangle might overlap ones we already checked
+			it = _dirtyRects.begin();
+			continue;
 		}
+
+		++it;
 	}
-*/
 
-	// Otherwise, add it as a separate one
-	_dirtyRects.push_back(rect);
+	_dirtyRects.push_back(area);
+
+	// Upper limit. Dirty rectangle overhead isn't that great either :P
+	if (_dirtyRects.size() > kMaxDirtyRects)
+		dirtyAll();
 }
 
 bool Graphics::dirtyRectsApply() {
@@ -445,6 +466,11 @@ void Graphics::requestRedraw(const Common::Rect &rect) {
 }
 
 void Graphics::redraw() {
+	if (!_dirtyAll && _dirtyRects.empty())
+		return;
+
+	updateSpriteBands();
+
 	if (_dirtyAll) {
 		redraw(Common::Rect(0, 0, _screenWidth, _screenHeight));
 		return;
@@ -472,8 +498,7 @@ void Graphics::redraw(Common::Rect rect) {
 	Common::Rect spriteArea = rect;
 	_room->clipToRoom(spriteArea);
 
-	for (SpriteQueue::iterator it = _spriteQueue.begin(); it != _spriteQueue.end(); ++it)
-		it->object->redraw(_screen, spriteArea);
+	redrawSprites(spriteArea);
 
 	if (_talk)
 		_talk->redraw(_screen, rect);
@@ -485,6 +510,64 @@ void Graphics::redraw(Common::Rect rect) {
 		_inventoryBox->redraw(_screen, rect);
 }
 
+void Graphics::updateSpriteBands() {
+	_spriteAreas.clear();
+	for (uint i = 0; i < _spriteBands.size(); i++)
+		_spriteBands[i].clear();
+
+	Common::Rect screenArea(0, 0, _screenWidth, _screenHeight);
+
+	for (SpriteQueue::iterator it = _spriteQueue.begin(); it != _spriteQueue.end(); ++it) {
+		SpriteArea sprite;
+
+		sprite.object = it->object;
+		sprite.area   = it->object->getArea();
+
+		sprite.area.clip(screenArea);
+		if (sprite.area.isEmpty())
+			continue;
+
+		uint n = _spriteAreas.size();
+		_spriteAreas.push_back(sprite);
+
+		int firstBand = sprite.area.top / kSpriteBandHeight;
+		int lastBand  = (sprite.area.bottom - 1) / kSpriteBandHeight;
+
+		for (int i = firstBand; i <= lastBand; i++)
+			_spriteBands[i].push_back(n);
+	}
+}
+
+void Graphics::redrawSprites(const Common::Rect &area) {
+	if (area.isEmpty())
+		return;
+
+	int firstBand = area.top / kSpriteBandHeight;
+	int lastBand  = (area.bottom - 1) / kSpriteBandHeight;
+
+	if (firstBand == lastBand) {
+		// Only look at the sprites in that band
+		const Common::Array<uint> &band = _spriteBands[firstBand];
+
+		for (uint i = 0; i < band.size(); i++) {
+			const SpriteArea &sprite = _spriteAreas[band[i]];
+
+			if (sprite.area.intersects(area))
+				sprite.object->redraw(_screen, area);
+		}
+
+		return;
+	}
+
+	// Spanning several bands, just check all areas without merging bands
+	for (uint i = 0; i < _spriteAreas.size(); i++) {
+		const SpriteArea &sprite = _spriteAreas[i];
+
+		if (sprite.area.intersects(area))
+			sprite.object->redraw(_screen, area);
+	}
+}
+
 bool Graphics::saveLoad(Common::Serializer &serializer, Resources &resources) {
 	if (serializer.isLoading()) {
 		_spriteQueue.clear();
@@ -28,6 +28,7 @@
 
 #include "common/rect.h"
 #include "common/list.h"
+#include "common/array.h"
 #include "common/frac.h"
 
 #include "engines/darkseed2/darkseed2.h"
@@ -206,6 +207,17 @@ private:
 	/** The animation frame sprites queue. */
 	SpriteQueue _spriteQueue;
 
+	/** A sprite's on-screen area, for culling. */
+	struct SpriteArea {
+		Common::Rect  area;   ///< The sprite's area, clipped to the screen.
+		SpriteObject *object; ///< The sprite's object.
+	};
+
+	/** The areas of all sprites in the queue, in drawing order. */
+	Common::Array<SpriteArea> _spriteAreas;
+	/** For each horizontal screen band, the sprites overlapping it, in drawing order. */
+	Common::Array< Common::Array<uint> > _spriteBands;
+
 	/** Initialize the game palette. */
 	void initPalette();
 
@@ -214,6 +226,11 @@ private:
 	/** Redraw that area of the game screen. */
 	void redraw(Common::Rect rect);
 
+	/** Sort the sprites in the queue into screen bands. */
+	void updateSpriteBands();
+	/** Redraw all sprites overlapping that area. */
+	void redrawSprites(const Common::Rect &area);
+
 	/** Dirty the whole screen. */
 	void dirtyAll();
 	/** Add that area to the dirty rectangles. */
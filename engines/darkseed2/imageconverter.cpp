@@ -23,6 +23,8 @@
  *
  */
 
+#include "common/endian.h"
+
 #include "engines/darkseed2/imageconverter.h"
 #include "engines/darkseed2/palette.h"
 
@@ -31,9 +33,13 @@ DECLARE_SINGLETON(DarkSeed2::ImageConverter);
 namespace DarkSeed2 {
 
 ImageConverter::ImageConverter() {
+	_colors555 = 0;
+
+	clearPaletteCache();
 }
 
 ImageConverter::~ImageConverter() {
+	delete[] _colors555;
 }
 
 void ImageConverter::registerStandardPalette(Palette &palette) {
@@ -53,6 +59,24 @@ const ::Graphics::PixelFormat &ImageConverter::getPixelFormat() const {
 
 void ImageConverter::setPixelFormat(const ::Graphics::PixelFormat &format) {
 	_format = format;
+
+	clearPaletteCache();
+
+	delete[] _colors555;
+	_colors555 = 0;
+
+	if (_format.bytesPerPixel != 2)
+		return;
+
+	// Converting 555 images happens a lot, so we look up every possible color
+	_colors555 = new uint16[0x8000];
+	for (uint32 i = 0; i < 0x8000; i++) {
+		const uint8 r = ((i & 0x001F)      ) << 3;
+		const uint8 g = ((i & 0x03E0) >>  5) << 3;
+		const uint8 b = ((i & 0x7C00) >> 10) << 3;
+
+		_colors555[i] = (uint16) _format.RGBToColor(r, g, b);
+	}
 }
 
 void ImageConverter::convert8bit(::Graphics::Surface &trueColor,
@@ -72,12 +96,7 @@ void ImageConverter::convert8bit(::Graphics::Surface &trueColor,
 	// For now, we only support 8bit->16bit conversion
 	assert(trueColor.bytesPerPixel == 2);
 
-	uint16 *dst = (uint16 *) trueColor.pixels;
-	const byte *src = (const byte *) paletted.pixels;
-
-	for (int32 y = 0; y < paletted.h; y++)
-		for (int32 x = 0; x < paletted.w; x++, dst++, src++)
-			*dst = (uint16) getColor(*src, palette);
+	convert8bit(trueColor, paletted, getConvertedPalette(palette));
 }
 
 void ImageConverter::convert8bit(::Graphics::Surface &trueColor,
@@ -102,12 +121,83 @@ void ImageConverter::convert8bitSystem(::Graphics::Surface &trueColor,
 	// For now, we only support 8bit->16bit conversion
 	assert(trueColor.bytesPerPixel == 2);
 
-	uint16 *dst = (uint16 *) trueColor.pixels;
+	// The system palette can change at any time, so it's converted anew each time
+	byte pal[1024];
+	g_system->getPaletteManager()->grabPalette(pal, 0, 256);
+
+	uint16 colors[256];
+	for (int i = 0; i < 256; i++)
+		colors[i] = (uint16) _format.RGBToColor(pal[i * 4 + 0], pal[i * 4 + 1], pal[i * 4 + 2]);
+
+	convert8bit(trueColor, paletted, colors);
+}
+
+void ImageConverter::convert8bit(::Graphics::Surface &trueColor,
+		const ::Graphics::Surface &paletted, const uint16 *colors) const {
+
 	const byte *src = (const byte *) paletted.pixels;
 
-	for (int32 y = 0; y < paletted.h; y++)
-		for (int32 x = 0; x < paletted.w; x++, dst++, src++)
-			*dst = (uint16) getColorSystem(*src);
+	for (int32 y = 0; y < paletted.h; y++) {
+		uint16 *dst = (uint16 *) trueColor.getBasePtr(0, y);
+
+		int32 x = 0;
+
+		// Look up four pixels at once
+		for (; (x + 4) <= paletted.w; x += 4, dst += 4, src += 4) {
+			dst[0] = colors[src[0]];
+			dst[1] = colors[src[1]];
+			dst[2] = colors[src[2]];
+			dst[3] = colors[src[3]];
+		}
+
+		for (; x < paletted.w; x++, dst++, src++)
+			*dst = colors[*src];
+	}
+}
+
+const uint16 *ImageConverter::getConvertedPalette(const Palette &palette) const {
+	// Palettes can be changed in place, so they're identified by their contents
+	for (uint i = 0; i < kPaletteCacheSize; i++) {
+		ConvertedPalette &cached = _paletteCache[i];
+
+		if (cached.valid && !memcmp(cached.palette, palette.get(), 768))
+			return cached.colors;
+	}
+
+	ConvertedPalette &cached = _paletteCache[_paletteCacheNext];
+
+	_paletteCacheNext = (_paletteCacheNext + 1) % kPaletteCacheSize;
+
+	memcpy(cached.palette, palette.get(), 768);
+	for (int i = 0; i < 256; i++)
+		cached.colors[i] = (uint16) getColor(i, palette);
+
+	cached.valid = true;
+
+	return cached.colors;
+}
+
+void ImageConverter::clearPaletteCache() {
+	for (uint i = 0; i < kPaletteCacheSize; i++)
+		_paletteCache[i].valid = false;
+
+	_paletteCacheNext = 0;
+}
+
+void ImageConverter::convert555(byte *img, const byte *src, int32 count, uint8 *transp) const {
+	// For now, we only support 555->16bit conversion
+	assert(_colors555);
+
+	uint16 *dst = (uint16 *) img;
+
+	for (int32 i = 0; i < count; i++, src += 2) {
+		const uint16 p = READ_BE_UINT16(src);
+
+		*dst++ = _colors555[p & 0x7FFF];
+
+		if (transp)
+			*transp++ = (p == 0) ? 1 : 0;
+	}
 }
 
 uint32 ImageConverter::readColor(const byte *img) const {
@@ -183,16 +273,4 @@ inline uint32 ImageConverter::getColor(uint8 c, const Palette &palette) const {
 	return _format.RGBToColor(r, g, b);
 }
 
-inline uint32 ImageConverter::getColorSystem(uint8 c) const {
-	byte pal[4];
-
-	g_system->getPaletteManager()->grabPalette(pal, c, 1);
-
-	const uint8 r = pal[0];
-	const uint8 g = pal[1];
-	const uint8 b = pal[2];
-
-	return _format.RGBToColor(r, g, b);
-}
-
 } // End of namespace DarkSeed2
@@ -59,6 +59,9 @@ public:
 	void convert8bitSystem(::Graphics::Surface &trueColor,
 			const ::Graphics::Surface &paletted) const;
 
+	/** Convert a row of big endian 555 pixels, optionally marking black ones as transparent. */
+	void convert555(byte *img, const byte *src, int32 count, uint8 *transp = 0) const;
+
 	uint32 readColor(const byte *img) const;
 	void writeColor(byte *img, uint32 color) const;
 	void swapColor(byte *img1, byte *img2) const;
@@ -82,6 +85,22 @@ private:
 
 	::Graphics::PixelFormat _format; ///< The target format.
 
+	uint16 *_colors555; ///< All 555 colors in the target format.
+
+	static const uint kPaletteCacheSize = 4;
+
+	/** A palette, converted to the target format. */
+	struct ConvertedPalette {
+		bool   valid;        ///< Does the entry hold a palette?
+		byte   palette[768]; ///< The original palette data.
+		uint16 colors[256];  ///< The colors in the target format.
+	};
+
+	/** The most recently converted palettes. */
+	mutable ConvertedPalette _paletteCache[kPaletteCacheSize];
+	/** The cache entry to be replaced next. */
+	mutable uint _paletteCacheNext;
+
 	Common::Stack<Palette *> _palettes; ///< The standard palette stack.
 
 	ImageConverter();
@@ -89,7 +108,15 @@ private:
 
 	inline Palette *getStandardPalette() const;
 	inline uint32 getColor(uint8 c, const Palette &palette) const;
-	inline uint32 getColorSystem(uint8 c) const;
+
+	/** Get the palette's colors in the target format. */
+	const uint16 *getConvertedPalette(const Palette &palette) const;
+	/** Clear the converted palettes. */
+	void clearPaletteCache();
+
+	/** Convert an 8bit image, using a table of colors in the target format. */
+	void convert8bit(::Graphics::Surface &trueColor,
+			const ::Graphics::Surface &paletted, const uint16 *colors) const;
 };
 
 } // End of namespace DarkSeed2
@@ -25,7 +25,6 @@
 
 #include "engines/darkseed2/inter.h"
 #include "engines/darkseed2/variables.h"
-#include "engines/darkseed2/datfile.h"
 #include "engines/darkseed2/sound.h"
 #include "engines/darkseed2/music.h"
 #include "engines/darkseed2/movie.h"
@@ -35,13 +34,16 @@
 #include "engines/darkseed2/room.h"
 #include "engines/darkseed2/conversationbox.h"
 #include "engines/darkseed2/events.h"
+#include "engines/darkseed2/roomconfig.h"
 #include "engines/darkseed2/saveload.h"
 
 namespace DarkSeed2 {
 
 template<>
 void SaveLoad::sync<ScriptInterpreter::Script>(Common::Serializer &serializer, ScriptInterpreter::Script &script) {
-	byte waitingFor = (byte) script.waitingFor;
+	// Scripts waiting for a condition just evaluate it again after loading
+	byte waitingFor = (script.waitingFor == ScriptInterpreter::kWaitCondition) ?
+		ScriptInterpreter::kWaitNone : (byte) script.waitingFor;
 
 	SaveLoad::sync(serializer, script.signature);
 
@@ -51,7 +53,8 @@ void SaveLoad::sync<ScriptInterpreter::Script>(Common::Serializer &serializer, S
 
 	SaveLoad::sync(serializer, waitingFor);
 
-	script.waitingFor = (ScriptInterpreter::Wait) waitingFor;
+	if (serializer.isLoading())
+		script.waitingFor = (ScriptInterpreter::Wait) waitingFor;
 }
 
 
@@ -60,6 +63,7 @@ ScriptInterpreter::Script::Script(ScriptChunk *chnk) {
 	action     = 0;
 	soundID    = -1;
 	waitingFor = kWaitNone;
+	waitChange = 0;
 
 	lastWaitDebug = 0;
 
@@ -92,7 +96,7 @@ ScriptInterpreter::OpcodeEntry ScriptInterpreter::_scriptFunc[kScriptActionNone]
 };
 
 ScriptInterpreter::ScriptInterpreter(DarkSeed2Engine &vm) : _vm(&vm) {
-	_updatesWithoutChanges = 0;
+	clear();
 }
 
 ScriptInterpreter::~ScriptInterpreter() {
@@ -104,37 +108,85 @@ bool ScriptInterpreter::hasScripts() const {
 
 void ScriptInterpreter::clear() {
 	_scripts.clear();
-	_updatesWithoutChanges = 0;
+
+	for (int i = 0; i < kWaitMAX; i++)
+		_waiting[i] = 0;
+
+	_wakeChange = 0;
+}
+
+void ScriptInterpreter::sleep(Script &script, Wait wait) {
+	assert(script.waitingFor == kWaitNone);
+
+	script.waitingFor = wait;
+	if (wait == kWaitCondition)
+		script.waitChange = _vm->_variables->getChangeCount();
+
+	_waiting[wait]++;
+}
+
+bool ScriptInterpreter::wake() {
+	bool woken = false;
+
+	if (_waiting[kWaitConversation] && !_vm->_graphics->getConversationBox().isActive()) {
+		wake(kWaitConversation);
+		woken = true;
+	}
+
+	if (_waiting[kWaitMovie] && !_vm->_movie->isPlaying()) {
+		wake(kWaitMovie);
+		woken = true;
+	}
+
+	uint32 changeCount = _vm->_variables->getChangeCount();
+	if (_waiting[kWaitCondition] && (changeCount != _wakeChange)) {
+		wake(kWaitCondition);
+		woken = true;
+	}
+
+	_wakeChange = changeCount;
+
+	return woken;
+}
+
+void ScriptInterpreter::wake(Wait wait) {
+	uint32 changeCount = _vm->_variables->getChangeCount();
+
+	for (Common::List<Script>::iterator script = _scripts.begin(); script != _scripts.end(); ++script) {
+		if (script->waitingFor != wait)
+			continue;
+
+		// Only wake up the ones that didn't already see the latest changes
+		if ((wait == kWaitCondition) && (script->waitChange == changeCount))
+			continue;
+
+		script->waitingFor = kWaitNone;
+		_waiting[wait]--;
+	}
+}
+
+void ScriptInterpreter::countWaiting() {
+	for (int i = 0; i < kWaitMAX; i++)
+		_waiting[i] = 0;
+
+	for (Common::List<Script>::const_iterator script = _scripts.begin(); script != _scripts.end(); ++script)
+		if (script->waitingFor != kWaitNone)
+			_waiting[script->waitingFor]++;
 }
 
 bool ScriptInterpreter::updateStatus() {
-	_updatesWithoutChanges++;
+	// Did anything happen that could let the scripts proceed?
+	bool changed = wake();
 
 	Common::List<Script>::iterator script;
 
-	// Interpret one action from every script in the queue
+	// Interpret one action from every script in the queue that isn't waiting
 	for (script = _scripts.begin(); script != _scripts.end(); ++script) {
 		if (_vm->shouldQuit())
 			break;
 
-		// Evaluating waiting orders
-		if (script->waitingFor != kWaitNone) {
-			bool waitEnd = false;
-
-			if      (script->waitingFor == kWaitConversation)
-				// Waiting for a conversation to end
-				waitEnd = !_vm->_graphics->getConversationBox().isActive();
-			else if (script->waitingFor == kWaitMovie)
-				// Waiting for a movie to end
-				waitEnd = !_vm->_movie->isPlaying();
-
-			if (waitEnd)
-				script->waitingFor = kWaitNone;
-			else
-				continue;
-
-			_updatesWithoutChanges = 0;
-		}
+		if (script->waitingFor != kWaitNone)
+			continue;
 
 		// Interpret the next command
 		Result result = interpret(*script);
@@ -144,16 +196,16 @@ bool ScriptInterpreter::updateStatus() {
 			// Invalid opcode
 			if (script->chunk)
 				script->chunk->seekEnd();
-			_updatesWithoutChanges = 0;
+			changed = true;
 		} else if (result == kResultOK) {
 			// Everything went okay
 			script->chunk->next();
 			script->lastWaitDebug = 0;
-			_updatesWithoutChanges = 0;
+			changed = true;
 		} else if (result == kResultStop) {
 			// Script stops here
 			script->chunk->seekEnd();
-			_updatesWithoutChanges = 0;
+			changed = true;
 		}
 	}
 
@@ -161,13 +213,44 @@ bool ScriptInterpreter::updateStatus() {
 	script = _scripts.begin();
 	while (script != _scripts.end()) {
 		if (!script->chunk || script->chunk->atEnd()) {
+			if (script->waitingFor != kWaitNone)
+				_waiting[script->waitingFor]--;
+
 			script = _scripts.erase(script);
-			_updatesWithoutChanges = 0;
+			changed = true;
 		} else
 			++script;
 	}
 
-	return _updatesWithoutChanges < 10;
+	// Conversations and movies end on their own
+	if (changed || _waiting[kWaitConversation] || _waiting[kWaitMovie])
+		return true;
+
+	if (!_waiting[kWaitCondition])
+		// Nothing left that would make the scripts proceed
+		return false;
+
+	// Variables changed since the condition waiters were woken, they'll wake up next update
+	if (_vm->_variables->getChangeCount() != _wakeChange)
+		return true;
+
+	return variablesChanging();
+}
+
+bool ScriptInterpreter::variablesChanging() const {
+	// Sounds that set a variable when they end
+	if (_vm->_sound->hasSoundVars())
+		return true;
+
+	// Room configs apply their change sets while they run
+	if (_vm->_roomConfMan->isChanging())
+		return true;
+
+	// So does the conversation box
+	if (_vm->_graphics->getConversationBox().isActive())
+		return true;
+
+	return false;
 }
 
 bool ScriptInterpreter::interpret(Common::List<ScriptChunk *> &chunks) {
@@ -186,9 +269,6 @@ bool ScriptInterpreter::interpret(Common::List<ScriptChunk *> &chunks) {
 		}
 	}
 
-	if (queued)
-		_updatesWithoutChanges = 0;
-
 	return queued;
 }
 
@@ -242,7 +322,7 @@ ScriptInterpreter::Result ScriptInterpreter::interpret(Script &script) {
 ScriptInterpreter::Result ScriptInterpreter::oXYRoom(Script &script) {
 	// Position changing
 
-	Common::Array<int32> args = DATFile::argGetInts(script.action->arguments, 5);
+	const Common::Array<int32> &args = script.action->ints;
 
 	warning("Going to %d+%d:%d (%d)", args[0], args[1], args[3], args[2]);
 
@@ -264,7 +344,7 @@ ScriptInterpreter::Result ScriptInterpreter::oCursor(Script &script) {
 ScriptInterpreter::Result ScriptInterpreter::oChange(Script &script) {
 	// Apply a variables change set
 
-	_vm->_variables->evalChange(script.action->arguments);
+	_vm->_variables->evalChange(script.action->changes);
 	return kResultOK;
 }
 
@@ -292,12 +372,13 @@ ScriptInterpreter::Result ScriptInterpreter::oMidi(Script &script) {
 ScriptInterpreter::Result ScriptInterpreter::oAnim(Script &script) {
 	// Animation / Video
 
-	Common::Array<Common::String> lArgs = DATFile::argGet(script.action->arguments);
-	if (lArgs.size() >= 5) {
-		if (!_vm->_movie->play(lArgs[4], atoi(lArgs[0].c_str()), atoi(lArgs[1].c_str())))
-			warning("oAnim: Failed playing video \"%s\"", lArgs[4].c_str());
+	if (!script.action->name.empty()) {
+		const Common::Array<int32> &args = script.action->ints;
+
+		if (!_vm->_movie->play(script.action->name, args[0], args[1]))
+			warning("oAnim: Failed playing video \"%s\"", script.action->name.c_str());
 		else
-			script.waitingFor = kWaitMovie;
+			sleep(script, kWaitMovie);
 	} else
 		warning("TODO: oAnim \"%s\"", script.action->arguments.c_str());
 
@@ -307,7 +388,7 @@ ScriptInterpreter::Result ScriptInterpreter::oAnim(Script &script) {
 ScriptInterpreter::Result ScriptInterpreter::oFrom(Script &script) {
 	// Changing position when coming from a specific room?
 
-	Common::Array<int32> args = DATFile::argGetInts(script.action->arguments, 3);
+	const Common::Array<int32> &args = script.action->ints;
 
 	if (!_vm->_events->cameFrom(args[2]))
 		return kResultStop;
@@ -337,7 +418,7 @@ ScriptInterpreter::Result ScriptInterpreter::oDialog(Script &script) {
 	_vm->_graphics->getInventoryBox().hide();
 	_vm->_graphics->getConversationBox().start(script.action->arguments);
 
-	script.waitingFor = kWaitConversation;
+	sleep(script, kWaitConversation);
 
 	return kResultOK;
 }
@@ -364,11 +445,12 @@ ScriptInterpreter::Result ScriptInterpreter::oSpeechVar(Script &script) {
 ScriptInterpreter::Result ScriptInterpreter::oWaitUntil(Script &script) {
 	// Wait until a condition is met
 
-	if (_vm->_variables->evalCondition(script.action->arguments))
+	if (_vm->_variables->evalCondition(script.action->condition))
 		// Condition is true => Proceed
 		return kResultOK;
 
-	// Condition is false => Keep waiting here
+	// Condition is false => Keep waiting here until the variables change
+	sleep(script, kWaitCondition);
 	return kResultWait;
 }
 
@@ -396,7 +478,8 @@ bool ScriptInterpreter::saveLoad(Common::Serializer &serializer, Resources &reso
 }
 
 bool ScriptInterpreter::loading(Resources &resources) {
-	_updatesWithoutChanges = 0;
+	countWaiting();
+	_wakeChange = _vm->_variables->getChangeCount();
 
 	// Rebuild the script list
 	for (Common::List<Script>::iterator script = _scripts.begin(); script != _scripts.end(); ++script) {
@@ -70,7 +70,9 @@ private:
 	enum Wait {
 		kWaitNone         = 0, ///< Waiting for nothing
 		kWaitConversation = 1, ///< Waiting for the conversation to end
-		kWaitMovie        = 2  ///< Waiting for a movie to end
+		kWaitMovie        = 2, ///< Waiting for a movie to end
+		kWaitCondition    = 3, ///< Waiting for the variables to change
+		kWaitMAX
 	};
 
 	/** A script state. */
@@ -94,6 +96,8 @@ private:
 
 		/** The event the script is currently waiting for. */
 		Wait waitingFor;
+		/** The variables change count when the script started waiting for a condition. */
+		uint32 waitChange;
 		/** Number of updates since the last wait debug message. */
 		int lastWaitDebug;
 
@@ -113,8 +117,10 @@ private:
 	/** All opcodes. */
 	static OpcodeEntry _scriptFunc[kScriptActionNone];
 
-	/** Number of updateStatus() class without any changes in the interpreter state. */
-	int _updatesWithoutChanges;
+	/** Number of scripts waiting for each event. */
+	uint _waiting[kWaitMAX];
+	/** The variables change count when the condition waiting scripts were last woken up. */
+	uint32 _wakeChange;
 
 	/** The currently active scripts. */
 	Common::List<Script> _scripts;
@@ -122,6 +128,17 @@ private:
 	// Interpreting helper
 	Result interpret(Script &script);
 
+	/** Let the script wait for that event. */
+	void sleep(Script &script, Wait wait);
+	/** Is anything outside the scripts going to change variables? */
+	bool variablesChanging() const;
+	/** Wake up the scripts waiting for events that happened, returns true if any were woken up. */
+	bool wake();
+	/** Wake up all scripts waiting for that event. */
+	void wake(Wait wait);
+	/** Count the scripts waiting for each event. */
+	void countWaiting();
+
 	// Opcodes
 	Result oXYRoom(Script &script);
 	Result oCursor(Script &script);
@@ -42,7 +42,7 @@ Inventory::Inventory(Resources &resources, Variables &variables,
 	_graphics  = &graphics;
 	_cursors   = &cursors;
 
-	_checkedLast = 0;
+	_checkedAt = 0;
 }
 
 Inventory::~Inventory() {
@@ -106,7 +106,7 @@ bool Inventory::parse(DATFile &dat) {
 
 			Sprite *sprite = new Sprite;
 
-			if (!sprite->loadFromImage(*_resources, it->spriteName)) {
+			if (!sprite->loadShared(*_resources, it->spriteName)) {
 				delete sprite;
 				return false;
 			}
@@ -127,7 +127,7 @@ bool Inventory::parse(DATFile &dat) {
 
 	assignSprites();
 
-	_checkedLast = 0;
+	_checkedAt = 0;
 
 	updateItems();
 
@@ -139,8 +139,8 @@ bool Inventory::parseLook(Item &item, ScriptChunk &lookScript) {
 
 	look.conditions = lookScript.getConditions();
 
-	const Common::List<ScriptChunk::Action> &actions = lookScript.getActions();
-	for (Common::List<ScriptChunk::Action>::const_iterator it = actions.begin(); it != actions.end(); ++it) {
+	const Common::Array<ScriptChunk::Action> &actions = lookScript.getActions();
+	for (Common::Array<ScriptChunk::Action>::const_iterator it = actions.begin(); it != actions.end(); ++it) {
 		if (     it->action == kScriptActionCursor)
 			look.spriteName = it->arguments;
 		else if (it->action == kScriptActionText)
@@ -157,8 +157,8 @@ bool Inventory::parseUse(Item &item, ScriptChunk &useScript) {
 
 	use.conditions = useScript.getConditions();
 
-	const Common::List<ScriptChunk::Action> &actions = useScript.getActions();
-	for (Common::List<ScriptChunk::Action>::const_iterator it = actions.begin(); it != actions.end(); ++it) {
+	const Common::Array<ScriptChunk::Action> &actions = useScript.getActions();
+	for (Common::Array<ScriptChunk::Action>::const_iterator it = actions.begin(); it != actions.end(); ++it) {
 		if (     it->action == kScriptActionCursor)
 			use.cursorName = it->arguments;
 		else if (it->action == kScriptActionChange)
@@ -202,17 +202,35 @@ const Inventory::Item *Inventory::findItem(const Common::String &name) const {
 	return 0;
 }
 
+uint32 Inventory::getVersion(const Item &item) const {
+	uint32 version = 0;
+
+	for (Common::Array<ItemLook>::const_iterator look = item.looks.begin(); look != item.looks.end(); ++look)
+		version = MAX(version, _variables->getVersion(look->conditions));
+	for (Common::Array<ItemUse>::const_iterator use = item.uses.begin(); use != item.uses.end(); ++use)
+		version = MAX(version, _variables->getVersion(use->conditions));
+
+	return version;
+}
+
 bool Inventory::updateItems() {
-	uint32 changedLast = _variables->getLastChanged();
-	if (changedLast <= _checkedLast)
+	uint32 changeCount = _variables->getChangeCount();
+	if (changeCount == _checkedAt)
 		// Nothing changed
 		return false;
 
 	bool changed = false;
 
-	_checkedLast = changedLast;
+	uint32 checkedAt = _checkedAt;
+
+	_checkedAt = changeCount;
 
 	for (Common::Array<Item>::iterator item = _items.begin(); item != _items.end(); ++item) {
+		// Conditions without variables have version 0, so always evaluate on the first check
+		if ((checkedAt != 0) && (getVersion(*item) <= checkedAt))
+			// None of the variables this item depends on changed
+			continue;
+
 		// Search for the new active look
 
 		ItemLook *curLook = item->curLook;
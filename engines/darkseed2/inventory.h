@@ -33,6 +33,7 @@
 #include "engines/darkseed2/darkseed2.h"
 #include "engines/darkseed2/objects.h"
 #include "engines/darkseed2/cursors.h"
+#include "engines/darkseed2/variables.h"
 
 namespace DarkSeed2 {
 
@@ -49,7 +50,7 @@ public:
 	/** An item look. */
 	struct ItemLook {
 		/** The conditions needed to be met for the look to be active. */
-		Common::List<Common::String> conditions;
+		Condition conditions;
 
 		Common::String spriteName; ///< The name of the sprite.
 		const Sprite  *sprite;     ///< The item's sprite.
@@ -60,7 +61,7 @@ public:
 	/** An item use. */
 	struct ItemUse {
 		/** The conditions needed to be met for the use to be active. */
-		Common::List<Common::String> conditions;
+		Condition conditions;
 
 		Common::String         cursorName; ///< The name of the cursor.
 		const Cursors::Cursor *cursor;     ///< The item's cursor.
@@ -107,7 +108,7 @@ private:
 
 	Common::Array<Item> _items; ///< All available items.
 
-	uint32 _checkedLast; ///< Timestamp of when the item conditions were checked last.
+	uint32 _checkedAt; ///< Variables change count when the item conditions were checked last.
 
 	// Parsing helpers
 	bool parse(DATFile &dat);
@@ -117,6 +118,9 @@ private:
 	/** Refresh the items' sprite pointers. */
 	void assignSprites();
 
+	/** Get the change count of the last change to any variable the item's conditions read. */
+	uint32 getVersion(const Item &item) const;
+
 	/** Update the items' looks and uses. */
 	bool updateItems();
 };
@@ -10,6 +10,7 @@ MODULE_OBJS := \
 	imageconverter.o \
 	font.o \
 	sprite.o \
+	spritecache.o \
 	graphics.o \
 	graphicalobject.o \
 	cursors.o \
@@ -57,6 +57,9 @@ void Options::syncSettings() {
 	// Subtitles
 	_subtitlesEnabled = ConfMan.getBool("subtitles");
 	_subtitleSpeed    = ConfMan.getInt("talkspeed");
+
+	// Resources
+	_mapArchives = ConfMan.hasKey("map_archives") && ConfMan.getBool("map_archives");
 }
 
 int Options::getVolumeSFX() const {
@@ -79,4 +82,8 @@ bool Options::getSubtitlesEnabled() const {
 	return _subtitlesEnabled;
 }
 
+bool Options::getMapArchives() const {
+	return _mapArchives;
+}
+
 } // End of namespace DarkSeed2
@@ -46,6 +46,8 @@ public:
 	int  getSubtitleSpeed() const;    ///< Get the subtitle speed.
 	bool getSubtitlesEnabled() const; ///< Are the subtitles enabled?
 
+	bool getMapArchives() const; ///< Keep uncompressed archives in memory?
+
 private:
 	int _volumeSFX;    ///< SFX volume.
 	int _volumeSpeech; ///< Speech volume.
@@ -53,6 +55,8 @@ private:
 
 	int  _subtitleSpeed;    ///< Subtitle speed.
 	bool _subtitlesEnabled; ///< Subtitles enabled?
+
+	bool _mapArchives; ///< Keep uncompressed archives in memory?
 };
 
 } // End of namespace DarkSeed2
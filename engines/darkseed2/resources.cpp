@@ -28,21 +28,123 @@
 
 #include "common/archive.h"
 #include "common/macresman.h"
+#include "common/savefile.h"
+#include "common/serializer.h"
 
 #include "engines/darkseed2/resources.h"
+#include "engines/darkseed2/saveload.h"
 
 namespace DarkSeed2 {
 
+/** Amount of uncompressed archive data to keep in memory. */
+static const uint32 kUncompressedBudget = 8 * 1024 * 1024;
+/** Amount of resources read ahead of time to keep in memory. */
+static const uint32 kPrefetchBudget     = 4 * 1024 * 1024;
+
+/** A stream reading directly from a part of shared archive data. */
+class ArchiveDataStream : public Common::MemoryReadStream {
+public:
+	ArchiveDataStream(ArchiveDataPtr data, uint32 offset, uint32 size) :
+		Common::MemoryReadStream(data->getData() + offset, size), _data(data) {
+	}
+
+private:
+	/** Keep the data alive for as long as the stream exists. */
+	ArchiveDataPtr _data;
+};
+
+ArchiveData::ArchiveData(byte *data, uint32 size) : _data(data), _size(size) {
+}
+
+ArchiveData::~ArchiveData() {
+	delete[] _data;
+}
+
+const byte *ArchiveData::getData() const {
+	return _data;
+}
+
+uint32 ArchiveData::getSize() const {
+	return _size;
+}
+
 Archive::Archive() {
 	_isIndexed = false;
+	_lastUsed  = 0;
+}
+
+bool Archive::getData(const Common::String &fileName, ArchiveDataPtr &data, uint32 &offset, uint32 &size) {
+	return false;
 }
 
-GlueArchive::GlueArchive() : Archive() {
+bool Archive::syncIndexCache(Common::Serializer &serializer) {
+	return false;
+}
+
+void Archive::listResources(Common::Array<Common::String> &names) const {
+	for (uint32 i = 0; i < _resources.size(); i++)
+		if (!_resources[i].fileName.empty())
+			names.push_back(_resources[i].fileName);
+}
+
+void Archive::mapEntry(uint32 n) {
+	const Common::String &fileName = _resources[n].fileName;
+
+	// Keep the first one if a name is listed twice
+	if (!fileName.empty() && !_entryMap.contains(fileName))
+		_entryMap.setVal(fileName, n);
+}
+
+const Archive::ResourceEntry *Archive::findEntry(const Common::String &fileName) const {
+	EntryMap::const_iterator entry = _entryMap.find(fileName);
+	if (entry == _entryMap.end())
+		return 0;
+
+	return &_resources[entry->_value];
+}
+
+void Archive::clearEntries() {
+	_resources.clear();
+	_entryMap.clear();
+}
+
+ArchiveDataPtr Archive::mapFile(Common::SeekableReadStream &file) {
+	uint32 size = file.size();
+	byte  *data = new byte[size];
+
+	file.seek(0);
+	if (file.read(data, size) != size)
+		error("Archive::mapFile(): Can't read archive data");
+
+	return ArchiveDataPtr(new ArchiveData(data, size));
+}
+
+Common::SeekableReadStream *Archive::createDataStream(ArchiveDataPtr data, uint32 offset, uint32 size) {
+	if ((offset > data->getSize()) || (size > (data->getSize() - offset))) {
+		warning("Archive::createDataStream(): Resource exceeds the archive (%d+%d vs. %d)",
+				offset, size, data->getSize());
+		return 0;
+	}
+
+	return new ArchiveDataStream(data, offset, size);
+}
+
+GlueArchive::GlueArchive(bool mapped) : Archive() {
+	_mapped     = mapped;
+	_compressed = false;
+
+	_fileSize = 0;
+
 	_file = 0;
+
+	_compressedFile   = 0;
+	_uncompressed     = 0;
+	_uncompressedSize = 0;
 }
 
 GlueArchive::~GlueArchive() {
 	delete _file;
+	delete _compressedFile;
 }
 
 bool GlueArchive::open(const Common::String &fileName, Archive *parentArchive) {
@@ -50,27 +152,50 @@ bool GlueArchive::open(const Common::String &fileName, Archive *parentArchive) {
 	return Common::File::exists(fileName);
 }
 
-void GlueArchive::index(ResourceMap &map) {
-	if (_isIndexed)
+void GlueArchive::openData() {
+	if (_file)
 		return;
 
-	if (!_file) {
-		// Open up the file if we have not done so already
-		Common::File *file = new Common::File();
-		assert(file->open(_fileName));
-		_file = file;
+	// Open up the file if we have not done so already
+	Common::File *file = new Common::File();
+	assert(file->open(_fileName));
+	_file = file;
+
+	// An indexed glue already knows whether it's compressed
+	if (!_isIndexed) {
+		_fileSize   = _file->size();
+		_compressed = isCompressed();
+	}
+
+	if (_compressed)
+		uncompressGlue();
+	else if (_mapped)
+		_data = mapFile(*_file);
 
-		if (isCompressed())
-			uncompressGlue();
+	if (_data) {
+		delete _file;
+		_file = createDataStream(_data, 0, _data->getSize());
 	}
+}
+
+void GlueArchive::index(ResourceMap &map) {
+	if (_isIndexed)
+		return;
+
+	openData();
 
 	debugC(3, kDebugResources, "Reading contents of glue file \"%s\"", _fileName.c_str());
 
+	// We only need the header uncompressed for now
+	uncompressGlue(2);
+
 	_file->seek(0);
 
 	uint16 glueResCount = _file->readUint16LE();
 	_resources.resize(glueResCount);
 
+	uncompressGlue(2 + glueResCount * 20);
+
 	debugC(4, kDebugResources, "Has %d resources", glueResCount);
 
 	for (uint16 i = 0; i < glueResCount; i++) {
@@ -95,6 +220,8 @@ void GlueArchive::index(ResourceMap &map) {
 		_resources[i].size = _file->readUint32LE();
 		_resources[i].offset = _file->readUint32LE();
 
+		mapEntry(i);
+
 		debugC(5, kDebugResources, "Resource \"%s\", offset %d, size %d",
 				resFile.c_str(), _resources[i].offset, _resources[i].size);
 	}
@@ -103,24 +230,92 @@ void GlueArchive::index(ResourceMap &map) {
 }
 
 Common::SeekableReadStream *GlueArchive::getStream(const Common::String &fileName) {
-	if (!_file)
+	openData();
+
+	const ResourceEntry *entry = findEntry(fileName);
+	if (!entry)
 		return 0;
 
-	for (uint32 i = 0; i < _resources.size(); i++) {
-		if (_resources[i].fileName.equalsIgnoreCase(fileName)) {
-			_file->seek(_resources[i].offset);
-			return _file->readStream(_resources[i].size);
-		}
-	}
+	uncompressGlue(entry->offset + entry->size);
+
+	if (_data)
+		return createDataStream(_data, entry->offset, entry->size);
+
+	_file->seek(entry->offset);
+	return _file->readStream(entry->size);
+}
 
-	return 0;
+bool GlueArchive::getData(const Common::String &fileName, ArchiveDataPtr &data, uint32 &offset, uint32 &size) {
+	const ResourceEntry *entry = findEntry(fileName);
+	if (!_data || !entry)
+		return false;
+
+	uncompressGlue(entry->offset + entry->size);
+
+	data   = _data;
+	offset = entry->offset;
+	size   = entry->size;
+	return true;
 }
 
 void GlueArchive::clearUncompressedData() {
+	// A mapped glue file stays in memory
+	if (_mapped && !_compressed)
+		return;
+
+	// The index stays valid, the data will be reopened when needed
 	delete _file;
-	_file = 0;
-	_isIndexed = false;
-	_resources.clear();
+	delete _compressedFile;
+	_file           = 0;
+	_compressedFile = 0;
+	_uncompressed   = 0;
+	_data.reset();
+}
+
+uint32 GlueArchive::getUncompressedSize() const {
+	// A mapped glue file stays in memory
+	if (!_compressed || !_data)
+		return 0;
+
+	return _data->getSize();
+}
+
+bool GlueArchive::syncIndexCache(Common::Serializer &serializer) {
+	bool indexed = _isIndexed;
+
+	SaveLoad::sync(serializer, indexed);
+	if (!indexed)
+		return true;
+
+	SaveLoad::sync(serializer, _fileSize);
+	SaveLoad::sync(serializer, _compressed);
+
+	uint32 resCount = _resources.size();
+	SaveLoad::sync(serializer, resCount);
+
+	if (serializer.isLoading()) {
+		// Make sure the glue file didn't change in the meantime
+		Common::File file;
+		if (!file.open(_fileName) || (((uint32) file.size()) != _fileSize))
+			return false;
+
+		clearEntries();
+		_resources.resize(resCount);
+	}
+
+	for (uint32 i = 0; i < resCount; i++) {
+		SaveLoad::sync(serializer, _resources[i].fileName);
+		SaveLoad::sync(serializer, _resources[i].offset);
+		SaveLoad::sync(serializer, _resources[i].size);
+
+		if (serializer.isLoading())
+			mapEntry(i);
+	}
+
+	if (serializer.isLoading())
+		_isIndexed = true;
+
+	return true;
 }
 
 void GlueArchive::uncompressGlue() {
@@ -129,11 +324,7 @@ void GlueArchive::uncompressGlue() {
 
 	byte inBuf[2048];
 
-	memset(inBuf, 0, 2048);
-
-	int nRead = _file->read(inBuf, 2048);
-
-	if (nRead != 2048)
+	if (_file->read(inBuf, 2048) != 2048)
 		error("GlueArchive::uncompressGlue(): "
 				"Can't uncompress glue file: Need at least 2048 bytes");
 
@@ -142,30 +333,52 @@ void GlueArchive::uncompressGlue() {
 	// Sanity check
 	assert(size < (10*1024*1024));
 
-	byte *outBuf = new byte[size];
+	_uncompressed     = new byte[size];
+	_uncompressedSize = 0;
+
+	memset(_uncompressed, 0, size);
 
-	memset(outBuf, 0, size);
+	_data = ArchiveDataPtr(new ArchiveData(_uncompressed, size));
+
+	// The chunks are uncompressed on demand, when a resource needs them
+	_compressedFile = _file;
+	_compressedFile->seek(0);
+	_file = 0;
+}
 
-	byte *oBuf = outBuf;
-	while (nRead != 0) {
-		uint32 toRead = 2040;
-		uint32 written;
+void GlueArchive::uncompressGlue(uint32 end) {
+	// Chunks can refer back to data of previous chunks,
+	// so everything before the offset has to be uncompressed too
+	while ((_uncompressedSize < end) && uncompressGlueNextChunk())
+		;
+}
 
-		if (nRead != 2048)
-			// Round up to the next 17 byte block
-			toRead = ((nRead + 16) / 17) * 17;
+bool GlueArchive::uncompressGlueNextChunk() {
+	if (!_compressedFile)
+		return false;
 
-		// Decompress that chunk
-		written = uncompressGlueChunk(oBuf, inBuf, toRead);
+	byte inBuf[2048];
 
-		oBuf += written;
+	memset(inBuf, 0, 2048);
 
-		memset(inBuf, 0, 2048);
-		nRead = _file->read(inBuf, 2048);
+	int nRead = _compressedFile->read(inBuf, 2048);
+	if (nRead == 0) {
+		// Everything's uncompressed, we don't need the file anymore
+		delete _compressedFile;
+		_compressedFile = 0;
+		return false;
 	}
 
-	delete _file;
-	_file = new Common::MemoryReadStream(outBuf, size, DisposeAfterUse::YES);
+	uint32 toRead = 2040;
+
+	if (nRead != 2048)
+		// Round up to the next 17 byte block
+		toRead = ((nRead + 16) / 17) * 17;
+
+	// Decompress that chunk
+	_uncompressedSize += uncompressGlueChunk(_uncompressed + _uncompressedSize, inBuf, toRead);
+
+	return true;
 }
 
 uint32 GlueArchive::uncompressGlueChunk(byte *outBuf, const byte *inBuf, int n) const {
@@ -273,6 +486,9 @@ void PGFArchive::index(ResourceMap &map) {
 
 	debugC(3, kDebugResources, "Reading contents of PGF file \"%s\"", _fileName.c_str());
 
+	if (_mapped)
+		_data = mapFile(_file);
+
 	_file.seek(0);
 
 	uint32 resCount = _file.readUint32BE();
@@ -296,6 +512,8 @@ void PGFArchive::index(ResourceMap &map) {
 		_resources[i].size = _file.readUint32BE();
 		_resources[i].offset = _file.readUint32BE() + startOffset;
 
+		mapEntry(i);
+
 		debugC(5, kDebugResources, "Resource \"%s\", offset %d, size %d",
 				resFile.c_str(), _resources[i].offset, _resources[i].size);
 	}
@@ -318,24 +536,42 @@ void PGFArchive::index(ResourceMap &map) {
 }
 
 Common::SeekableReadStream *PGFArchive::getStream(const Common::String &fileName) {
-	for (uint32 i = 0; i < _resources.size(); i++) {
-		if (_resources[i].fileName.equalsIgnoreCase(fileName)) {
-			if (_resources[i].size == 0)
-				return 0;
-			if (!_file.isOpen())
-				assert(_file.open(_fileName));
-			_file.seek(_resources[i].offset);
-			Common::SeekableReadStream *stream = _file.readStream(_resources[i].size);
-			_file.close();
-			return stream;
-		}
-	}
+	const ResourceEntry *entry = findEntry(fileName);
+	if (!entry || (entry->size == 0))
+		return 0;
+
+	if (_data)
+		return createDataStream(_data, entry->offset, entry->size);
+
+	if (!_file.isOpen())
+		assert(_file.open(_fileName));
+	_file.seek(entry->offset);
+	Common::SeekableReadStream *stream = _file.readStream(entry->size);
+	_file.close();
+	return stream;
+}
+
+bool PGFArchive::getData(const Common::String &fileName, ArchiveDataPtr &data, uint32 &offset, uint32 &size) {
+	const ResourceEntry *entry = findEntry(fileName);
+	if (!_data || !entry)
+		return false;
+
+	data   = _data;
+	offset = entry->offset;
+	size   = entry->size;
+	return true;
+}
+
+void PGFArchive::listResources(Common::Array<Common::String> &names) const {
+	Archive::listResources(names);
 
-	return 0;
+	for (uint32 i = 0; i < _subArchives.size(); i++)
+		_subArchives[i]->listResources(names);
 }
 
 TNDArchive::TNDArchive() : Archive() {
 	_file = 0;
+	_dataOffset = 0;
 }
 
 TNDArchive::~TNDArchive() {
@@ -346,7 +582,12 @@ bool TNDArchive::open(const Common::String &fileName, Archive *parentArchive) {
 	if (!parentArchive)
 		return false;
 
-	_file = parentArchive->getStream(fileName);
+	uint32 dataSize;
+	if (parentArchive->getData(fileName, _data, _dataOffset, dataSize))
+		_file = createDataStream(_data, _dataOffset, dataSize);
+	else
+		_file = parentArchive->getStream(fileName);
+
 	if (!_file)
 		return true;
 
@@ -377,6 +618,8 @@ void TNDArchive::index(ResourceMap &map) {
 		_resources[i].fileName = txtFile;
 		_resources[i].size = _file->readUint32BE();
 		_resources[i].offset = _file->readUint32BE() + startOffset;
+
+		mapEntry(i);
 	}
 
 	_isIndexed = true;
@@ -386,14 +629,15 @@ Common::SeekableReadStream *TNDArchive::getStream(const Common::String &fileName
 	if (!_file)
 		return 0;
 
-	for (uint32 i = 0; i < _resources.size(); i++) {
-		if (_resources[i].fileName.equalsIgnoreCase(fileName)) {
-			_file->seek(_resources[i].offset);
-			return _file->readStream(_resources[i].size);
-		}
-	}
+	const ResourceEntry *entry = findEntry(fileName);
+	if (!entry)
+		return 0;
+
+	if (_data)
+		return createDataStream(_data, _dataOffset + entry->offset, entry->size);
 
-	return 0;
+	_file->seek(entry->offset);
+	return _file->readStream(entry->size);
 }
 
 SaturnGlueArchive::~SaturnGlueArchive() {
@@ -437,6 +681,8 @@ void SaturnGlueArchive::index(ResourceMap &map) {
 		_resources[i].size     = _indexFile.readUint32BE();
 		_resources[i].offset   = _indexFile.readUint32BE();
 
+		mapEntry(i);
+
 		debugC(5, kDebugResources, "Resource \"%s\", offset %d, size %d",
 				resFile.c_str(), _resources[i].offset, _resources[i].size);
 	}
@@ -459,14 +705,19 @@ void SaturnGlueArchive::index(ResourceMap &map) {
 }
 
 Common::SeekableReadStream *SaturnGlueArchive::getStream(const Common::String &fileName) {
-	for (uint32 i = 0; i < _resources.size(); i++) {
-		if (_resources[i].fileName.equalsIgnoreCase(fileName)) {
-			_glueFile.seek(_resources[i].offset);
-			return _glueFile.readStream(_resources[i].size);
-		}
-	}
+	const ResourceEntry *entry = findEntry(fileName);
+	if (!entry)
+		return 0;
+
+	_glueFile.seek(entry->offset);
+	return _glueFile.readStream(entry->size);
+}
+
+void SaturnGlueArchive::listResources(Common::Array<Common::String> &names) const {
+	Archive::listResources(names);
 
-	return 0;
+	for (uint32 i = 0; i < _subArchives.size(); i++)
+		_subArchives[i]->listResources(names);
 }
 
 MacResourceForkArchive::MacResourceForkArchive(uint32 type) : Archive() {
@@ -513,6 +764,20 @@ Common::SeekableReadStream *MacResourceForkArchive::getStream(const Common::Stri
 	return _resFork->getResource(fileName);
 }
 
+void MacResourceForkArchive::listResources(Common::Array<Common::String> &names) const {
+	if (!_resFork)
+		return;
+
+	Common::MacResIDArray idArray = _resFork->getResIDArray(_type);
+
+	for (uint32 i = 0; i < idArray.size(); i++) {
+		Common::String fileName = _resFork->getResName(_type, idArray[i]);
+
+		if (!fileName.empty())
+			names.push_back(fileName);
+	}
+}
+
 bool MacTextArchive::open(const Common::String &fileName, Archive *parentArchive) {
 	_fileName = fileName;
 	return Common::File::exists(fileName);
@@ -551,6 +816,8 @@ void MacTextArchive::index(ResourceMap &map) {
 		_resources[i].size = _file.readUint16BE();
 		_resources[i].offset = _file.readUint32BE();
 
+		mapEntry(i);
+
 		debugC(5, kDebugResources, "Resource \"%s\", offset %d, size %d",
 				resFile.c_str(), _resources[i].offset, _resources[i].size);
 	}
@@ -560,18 +827,16 @@ void MacTextArchive::index(ResourceMap &map) {
 }
 
 Common::SeekableReadStream *MacTextArchive::getStream(const Common::String &fileName) {
-	for (uint32 i = 0; i < _resources.size(); i++) {
-		if (_resources[i].fileName.equalsIgnoreCase(fileName)) {
-			if (!_file.isOpen())
-				assert(_file.open(_fileName));
-			_file.seek(_resources[i].offset);
-			Common::SeekableReadStream *stream = _file.readStream(_resources[i].size);
-			_file.close();
-			return stream;
-		}
-	}
+	const ResourceEntry *entry = findEntry(fileName);
+	if (!entry)
+		return 0;
 
-	return 0;
+	if (!_file.isOpen())
+		assert(_file.open(_fileName));
+	_file.seek(entry->offset);
+	Common::SeekableReadStream *stream = _file.readStream(entry->size);
+	_file.close();
+	return stream;
 }
 
 bool MacWalkArchive::open(const Common::String &fileName, Archive *parentArchive) {
@@ -609,6 +874,8 @@ void MacWalkArchive::index(ResourceMap &map) {
 		_resources[i].size = _file.readUint32BE();
 		_resources[i].offset = _file.readUint32BE();
 
+		mapEntry(i);
+
 		debugC(5, kDebugResources, "Resource \"%s\", offset %d, size %d",
 				resFile.c_str(), _resources[i].offset, _resources[i].size);
 	}
@@ -618,18 +885,16 @@ void MacWalkArchive::index(ResourceMap &map) {
 }
 
 Common::SeekableReadStream *MacWalkArchive::getStream(const Common::String &fileName) {
-	for (uint32 i = 0; i < _resources.size(); i++) {
-		if (_resources[i].fileName.equalsIgnoreCase(fileName)) {
-			if (!_file.isOpen())
-				assert(_file.open(_fileName));
-			_file.seek(_resources[i].offset);
-			Common::SeekableReadStream *stream = _file.readStream(_resources[i].size);
-			_file.close();
-			return stream;
-		}
-	}
+	const ResourceEntry *entry = findEntry(fileName);
+	if (!entry)
+		return 0;
 
-	return 0;
+	if (!_file.isOpen())
+		assert(_file.open(_fileName));
+	_file.seek(entry->offset);
+	Common::SeekableReadStream *stream = _file.readStream(entry->size);
+	_file.close();
+	return stream;
 }
 
 bool MacRoomArchive::open(const Common::String &fileName, Archive *parentArchive) {
@@ -676,6 +941,8 @@ void MacRoomArchive::index(ResourceMap &map) {
 		_resources[i].size = _file.readUint32BE();
 		_resources[i].offset = _file.readUint32BE();
 
+		mapEntry(i);
+
 		debugC(5, kDebugResources, "Resource \"%s\", offset %d, size %d",
 				resFile.c_str(), _resources[i].offset, _resources[i].size);
 	}
@@ -685,25 +952,28 @@ void MacRoomArchive::index(ResourceMap &map) {
 }
 
 Common::SeekableReadStream *MacRoomArchive::getStream(const Common::String &fileName) {
-	for (uint32 i = 0; i < _resources.size(); i++) {
-		if (_resources[i].fileName.equalsIgnoreCase(fileName)) {
-			if (!_file.isOpen())
-				assert(_file.open(_fileName));
-			_file.seek(_resources[i].offset);
-			Common::SeekableReadStream *stream = _file.readStream(_resources[i].size);
-			_file.close();
-			return stream;
-		}
-	}
+	const ResourceEntry *entry = findEntry(fileName);
+	if (!entry)
+		return 0;
 
-	return 0;
+	if (!_file.isOpen())
+		assert(_file.open(_fileName));
+	_file.seek(entry->offset);
+	Common::SeekableReadStream *stream = _file.readStream(entry->size);
+	_file.close();
+	return stream;
 }
 
 Resources::Resources() {
+	_mapArchives  = false;
+	_useCount     = 0;
+	_prefetchSize = 0;
+
 	clear();
 }
 
 Resources::~Resources() {
+	saveIndexCache();
 	clear();
 }
 
@@ -716,6 +986,14 @@ const VersionFormats &Resources::getVersionFormats() {
 	return _versionFormats;
 }
 
+void Resources::setMapArchives(bool mapArchives) {
+	_mapArchives = mapArchives;
+}
+
+void Resources::setIndexCache(const Common::String &indexCache) {
+	_indexCache = indexCache;
+}
+
 bool Resources::index(const char *fileName) {
 	debugC(1, kDebugResources, "Resource index file \"%s\"", fileName);
 
@@ -726,6 +1004,14 @@ bool Resources::index(const char *fileName) {
 	if (!indexFile.open(fileName))
 		return false;
 
+	_indexFile     = fileName;
+	_indexFileSize = indexFile.size();
+
+	if (loadIndexCache()) {
+		debugC(1, kDebugResources, "Using cached resource index \"%s\"", _indexCache.c_str());
+		return true;
+	}
+
 	uint16 resCount = 0;
 
 	// Read the different sections of the index file
@@ -736,6 +1022,9 @@ bool Resources::index(const char *fileName) {
 	if (!readIndexResources(indexFile, resCount))
 		return false;
 
+	_indexCacheDirty = true;
+	saveIndexCache();
+
 	return true;
 }
 
@@ -760,18 +1049,18 @@ bool Resources::indexPGF() {
 		return false;
 	}
 
-	_archives[0]->index(_resources);
+	indexArchive(*_archives[0]);
 
 	// Indexing all PGFs
 
 	Common::ArchiveMemberList::const_iterator it = pgfs.begin();
 	for (uint i = 1; it != pgfs.end(); ++it, ++i) {
-		_archives[i] = new PGFArchive();
+		_archives[i] = new PGFArchive(_mapArchives);
 
 		if (!_archives[i]->open((*it)->getName()))
 			return false;
 
-		_archives[i]->index(_resources);
+		indexArchive(*_archives[i]);
 	}
 
 	return true;
@@ -786,7 +1075,7 @@ bool Resources::addMacResourceFork(const Common::String &fileName, uint32 type)
 		return false;
 	}
 
-	archive->index(_resources);
+	indexArchive(*archive);
 	_archives.push_back(archive);
 	return true;
 }
@@ -800,7 +1089,7 @@ bool Resources::addMacRoomArchive(const Common::String &fileName) {
 		return false;
 	}
 
-	archive->index(_resources);
+	indexArchive(*archive);
 	_archives.push_back(archive);
 	return true;
 }
@@ -839,7 +1128,7 @@ bool Resources::indexMacResources() {
 		delete archive;
 		return false;
 	} else {
-		archive->index(_resources);
+		indexArchive(*archive);
 		_archives.push_back(archive);
 	}
 
@@ -850,7 +1139,7 @@ bool Resources::indexMacResources() {
 		delete archive;
 		return false;
 	} else {
-		archive->index(_resources);
+		indexArchive(*archive);
 		_archives.push_back(archive);
 	}
 
@@ -871,11 +1160,265 @@ void Resources::clear() {
 
 	_resources.clear();
 	_archives.clear();
+
+	_frameIndex.clear();
+	_frameIndexFiles = false;
+
+	_prefetchQueue.clear();
+	_prefetchQueued.clear();
+	_prefetchOrder.clear();
+	_prefetched.clear();
+	_prefetchSize = 0;
+
+	_indexFile.clear();
+	_indexFileSize   = 0;
+	_indexCacheDirty = false;
 }
 
 void Resources::clearUncompressedData() {
+	// Good time to remember what we've indexed so far
+	saveIndexCache();
+
+	trimUncompressedData(0);
+}
+
+void Resources::prefetch(const Common::String &resource) {
+	// Only resources found in archives need to be read ahead
+	if (!_resources.contains(resource) || _prefetched.contains(resource) || _prefetchQueued.contains(resource))
+		return;
+
+	_prefetchQueue.push_back(resource);
+	_prefetchQueued.setVal(resource, true);
+}
+
+bool Resources::prefetchNext() {
+	if (_prefetchQueue.empty())
+		return false;
+
+	Common::String resource = _prefetchQueue.front();
+	_prefetchQueue.pop_front();
+	_prefetchQueued.erase(resource);
+
+	readPrefetched(resource);
+	return true;
+}
+
+Common::SeekableReadStream *Resources::prefetchResource(const Common::String &resource) {
+	// Plain files don't need to be read ahead
+	if (!_resources.contains(resource) || Common::File::exists(resource))
+		return getResource(resource);
+
+	ArchiveDataPtr prefetched = readPrefetched(resource);
+	if (!prefetched)
+		error("Resources::prefetchResource(): Could not open resource '%s'", resource.c_str());
+
+	return new ArchiveDataStream(prefetched, 0, prefetched->getSize());
+}
+
+ArchiveDataPtr Resources::findPrefetched(const Common::String &resource) const {
+	PrefetchMap::const_iterator prefetched = _prefetched.find(resource);
+	if (prefetched == _prefetched.end())
+		return ArchiveDataPtr();
+
+	return prefetched->_value;
+}
+
+ArchiveDataPtr Resources::readPrefetched(const Common::String &resource) {
+	ArchiveDataPtr prefetched = findPrefetched(resource);
+	if (prefetched)
+		return prefetched;
+
+	debugC(3, kDebugResources, "Prefetching resource \"%s\"", resource.c_str());
+
+	// Not going through getResource(), so that reading ahead doesn't make an
+	// archive look recently used and have the current room's glue cleared
+	Common::SeekableReadStream *stream = getArchive(resource)->getStream(resource);
+	if (!stream)
+		return ArchiveDataPtr();
+
+	uint32 size = stream->size();
+	byte  *data = new byte[size];
+
+	stream->read(data, size);
+	delete stream;
+
+	prefetched = ArchiveDataPtr(new ArchiveData(data, size));
+
+	_prefetched.setVal(resource, prefetched);
+	_prefetchOrder.push_back(resource);
+	_prefetchSize += size;
+
+	// Throw away the oldest ones if we're over budget
+	while ((_prefetchSize > kPrefetchBudget) && (_prefetchOrder.size() > 1)) {
+		_prefetchSize -= _prefetched.getVal(_prefetchOrder.front())->getSize();
+		_prefetched.erase(_prefetchOrder.front());
+		_prefetchOrder.pop_front();
+	}
+
+	return prefetched;
+}
+
+void Resources::trimUncompressedData(Archive *keep) {
+	uint32 size = 0;
 	for (uint32 i = 0; i < _archives.size(); i++)
-		_archives[i]->clearUncompressedData();
+		size += _archives[i]->getUncompressedSize();
+
+	while (size > kUncompressedBudget) {
+		Archive *oldest = 0;
+
+		for (uint32 i = 0; i < _archives.size(); i++) {
+			Archive *archive = _archives[i];
+
+			if ((archive == keep) || (archive->getUncompressedSize() == 0))
+				continue;
+
+			if (!oldest || (archive->getLastUsed() < oldest->getLastUsed()))
+				oldest = archive;
+		}
+
+		if (!oldest)
+			break;
+
+		debugC(2, kDebugResources, "Clearing uncompressed data of \"%s\"", oldest->getFileName().c_str());
+
+		size -= oldest->getUncompressedSize();
+		oldest->clearUncompressedData();
+	}
+}
+
+bool Resources::loadIndexCache() {
+	if (_indexCache.empty())
+		return false;
+
+	Common::InSaveFile *file = SaveLoad::openForLoading(_indexCache);
+	if (!file)
+		return false;
+
+	Common::Serializer serializer(file, 0);
+
+	bool loaded = syncIndexCache(serializer) && !file->err();
+
+	delete file;
+
+	if (!loaded) {
+		debugC(1, kDebugResources, "Resource index cache \"%s\" is outdated", _indexCache.c_str());
+
+		// Throw away what we've got so far, but remember the index file
+		Common::String indexFile     = _indexFile;
+		uint32         indexFileSize = _indexFileSize;
+
+		clear();
+
+		_indexFile     = indexFile;
+		_indexFileSize = indexFileSize;
+	}
+
+	return loaded;
+}
+
+void Resources::saveIndexCache() {
+	if (_indexCache.empty() || _indexFile.empty() || !_indexCacheDirty)
+		return;
+
+	Common::OutSaveFile *file = SaveLoad::openForSaving(_indexCache);
+	if (!file)
+		return;
+
+	Common::Serializer serializer(0, file);
+
+	if (!syncIndexCache(serializer) || !file->flush() || file->err())
+		warning("Resources::saveIndexCache(): Can't write index cache \"%s\"", _indexCache.c_str());
+
+	delete file;
+
+	_indexCacheDirty = false;
+}
+
+bool Resources::syncIndexCache(Common::Serializer &serializer) {
+	static const uint32 kIndexCacheTag     = MKID_BE('DSIC');
+	static const uint32 kIndexCacheVersion = 1;
+
+	uint32 tag     = kIndexCacheTag;
+	uint32 version = kIndexCacheVersion;
+
+	SaveLoad::sync(serializer, tag);
+	SaveLoad::sync(serializer, version);
+
+	if ((tag != kIndexCacheTag) || (version != kIndexCacheVersion))
+		return false;
+
+	// The cache has to belong to this exact index file
+	Common::String indexFile     = _indexFile;
+	uint32         indexFileSize = _indexFileSize;
+
+	SaveLoad::sync(serializer, indexFile);
+	SaveLoad::sync(serializer, indexFileSize);
+
+	if (!indexFile.equalsIgnoreCase(_indexFile) || (indexFileSize != _indexFileSize))
+		return false;
+
+	// The glue files, together with their indices where already known
+	uint32 archiveCount = _archives.size();
+	SaveLoad::sync(serializer, archiveCount);
+
+	if (serializer.isLoading()) {
+		if (archiveCount > 0xFFFF)
+			return false;
+
+		_archives.resize(archiveCount);
+		for (uint32 i = 0; i < archiveCount; i++)
+			_archives[i] = 0;
+	}
+
+	for (uint32 i = 0; i < archiveCount; i++) {
+		Common::String fileName;
+		if (serializer.isSaving())
+			fileName = _archives[i]->getFileName();
+
+		SaveLoad::sync(serializer, fileName);
+
+		if (serializer.isLoading()) {
+			_archives[i] = new GlueArchive(_mapArchives);
+			if (!_archives[i]->open(fileName))
+				return false;
+		}
+
+		if (!_archives[i]->syncIndexCache(serializer))
+			return false;
+	}
+
+	// Which resource is found in which glue file
+	uint32 resCount = _resources.size();
+	SaveLoad::sync(serializer, resCount);
+
+	if (serializer.isSaving()) {
+		for (ResourceMap::iterator res = _resources.begin(); res != _resources.end(); ++res) {
+			Common::String resFile = res->_key;
+
+			uint16 archive = 0;
+			while ((archive < _archives.size()) && (_archives[archive] != res->_value))
+				archive++;
+
+			SaveLoad::sync(serializer, resFile);
+			SaveLoad::sync(serializer, archive);
+		}
+	} else {
+		for (uint32 i = 0; i < resCount; i++) {
+			Common::String resFile;
+			uint16 archive;
+
+			SaveLoad::sync(serializer, resFile);
+			SaveLoad::sync(serializer, archive);
+
+			if (archive >= _archives.size())
+				return false;
+
+			_resources.setVal(resFile, _archives[archive]);
+			addFrame(resFile);
+		}
+	}
+
+	return true;
 }
 
 bool Resources::readIndexHeader(Common::File &indexFile, uint16 &resCount) {
@@ -901,7 +1444,7 @@ bool Resources::readIndexGlues(Common::File &indexFile) {
 
 		Common::String fileName = (const char *)buffer;
 
-		_archives[i] = new GlueArchive();
+		_archives[i] = new GlueArchive(_mapArchives);
 
 		if (!_archives[i]->open(fileName)) {
 			warning("Could not open Glue file '%s'", fileName.c_str());
@@ -935,6 +1478,7 @@ bool Resources::readIndexResources(Common::File &indexFile, uint16 resCount) {
 		}
 
 		_resources[resFile] = _archives[archive];
+		addFrame(resFile);
 
 		// Unknown
 		indexFile.skip(8);
@@ -950,6 +1494,69 @@ bool Resources::hasResource(const Common::String &resource) {
 	return Common::File::exists(resource) || _resources.contains(resource);
 }
 
+uint8 Resources::getFrameCount(const Common::String &base, const Common::String &extension) {
+	// Archive resources are added while indexing, plain files once on first use
+	if (!_frameIndexFiles)
+		indexFrameFiles();
+
+	FrameIndex::iterator frames = _frameIndex.find(addExtension(base, extension));
+	if (frames == _frameIndex.end())
+		return 0;
+
+	return frames->_value;
+}
+
+void Resources::indexArchive(Archive &archive) {
+	archive.index(_resources);
+
+	Common::Array<Common::String> names;
+	archive.listResources(names);
+
+	for (uint32 i = 0; i < names.size(); i++)
+		addFrame(names[i]);
+}
+
+void Resources::indexFrameFiles() {
+	// Plain files take precedence in getResource(), so they count as well
+	Common::ArchiveMemberList files;
+	SearchMan.listMatchingMembers(files, "*??*");
+
+	for (Common::ArchiveMemberList::const_iterator it = files.begin(); it != files.end(); ++it)
+		addFrame((*it)->getName());
+
+	_frameIndexFiles = true;
+
+	debugC(2, kDebugResources, "Indexed %d numbered resource sequences", _frameIndex.size());
+}
+
+bool Resources::isFrameNumber(const char *str, const char *end) {
+	return ((end - str) >= 2) && isdigit((unsigned char) end[-2]) && isdigit((unsigned char) end[-1]);
+}
+
+void Resources::addFrame(const Common::String &resource) {
+	const char *str = resource.c_str();
+	const char *dot = str + resource.size();
+
+	// Mac resources have no extension, so the number is at the very end there
+	if (!isFrameNumber(str, dot)) {
+		dot = strrchr(str, '.');
+		if (!dot || !isFrameNumber(str, dot))
+			return;
+	}
+
+	uint8 frame = (dot[-2] - '0') * 10 + (dot[-1] - '0');
+	if (frame == 0)
+		return;
+
+	Common::String sequence = Common::String(str, dot - 2) + dot;
+
+	FrameIndex::iterator frames = _frameIndex.find(sequence);
+	if (frames == _frameIndex.end())
+		_frameIndex.setVal(sequence, frame);
+	else if (frames->_value < frame)
+		frames->_value = frame;
+}
+
 Common::SeekableReadStream *Resources::getResource(const Common::String &resource) {
 	debugC(3, kDebugResources, "Getting resource \"%s\"", resource.c_str());
 
@@ -960,23 +1567,38 @@ Common::SeekableReadStream *Resources::getResource(const Common::String &resourc
 
 	delete plainFile;
 
-	if (!_resources.contains(resource))
-		error("Resources::getResource(): Resource \"%s\" does not exist",
-				resource.c_str());
-
-	Archive *archive = _resources[resource];
+	ArchiveDataPtr prefetched = findPrefetched(resource);
+	if (prefetched)
+		return new ArchiveDataStream(prefetched, 0, prefetched->getSize());
 
-	if (!archive->isIndexed())
-		archive->index(_resources);
+	Archive *archive = getArchive(resource);
 
 	Common::SeekableReadStream *stream = archive->getStream(resource);
 
 	if (!stream)
 		error("Resources::getResource(): Could not open resource '%s'", resource.c_str());
 
+	archive->setLastUsed(++_useCount);
+	trimUncompressedData(archive);
+
 	return stream;
 }
 
+Archive *Resources::getArchive(const Common::String &resource) {
+	if (!_resources.contains(resource))
+		error("Resources::getArchive(): Resource \"%s\" does not exist",
+				resource.c_str());
+
+	Archive *archive = _resources[resource];
+
+	if (!archive->isIndexed()) {
+		indexArchive(*archive);
+		_indexCacheDirty = true;
+	}
+
+	return archive;
+}
+
 Common::String Resources::addExtension(const Common::String &name, const Common::String &extension) {
 	if (name.empty() || extension.empty())
 		return name;
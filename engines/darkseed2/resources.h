@@ -30,7 +30,9 @@
 #include "common/util.h"
 #include "common/str.h"
 #include "common/array.h"
+#include "common/list.h"
 #include "common/hashmap.h"
+#include "common/ptr.h"
 
 #include "engines/darkseed2/darkseed2.h"
 #include "engines/darkseed2/versionformats.h"
@@ -38,12 +40,30 @@
 namespace Common {
 	class SeekableReadStream;
 	class MacResManager;
+	class Serializer;
 }
 
 namespace DarkSeed2 {
 
 class Archive;
 
+/** A block of archive data held in memory, shared by all streams reading from it. */
+class ArchiveData {
+public:
+	/** Take over this data block. */
+	ArchiveData(byte *data, uint32 size);
+	~ArchiveData();
+
+	const byte *getData() const;
+	uint32 getSize() const;
+
+private:
+	byte *_data;
+	uint32 _size;
+};
+
+typedef Common::SharedPtr<ArchiveData> ArchiveDataPtr;
+
 typedef Common::HashMap<Common::String, Archive *, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> ResourceMap;
 
 /** An archive file. */
@@ -61,43 +81,104 @@ public:
 	/** Get the resource stream, returns 0 upon failure */
 	virtual Common::SeekableReadStream *getStream(const Common::String &fileName) = 0;
 
+	/** Get the in-memory data a resource lives in, returns false if it isn't held in memory. */
+	virtual bool getData(const Common::String &fileName, ArchiveDataPtr &data, uint32 &offset, uint32 &size);
+
 	/** Has the archive already been indexed? */
 	bool isIndexed() const { return _isIndexed; }
 
+	/** List the names of all resources found while indexing */
+	virtual void listResources(Common::Array<Common::String> &names) const;
+
 	/** Get the file name of the archive */
 	Common::String getFileName() const { return _fileName; }
 
 	/** Clear uncompressed data */
 	virtual void clearUncompressedData() {}
 
+	/** Get the amount of memory held by uncompressed data that could be cleared */
+	virtual uint32 getUncompressedSize() const { return 0; }
+
+	/** Get when the archive was last used */
+	uint32 getLastUsed() const { return _lastUsed; }
+	/** Set when the archive was last used */
+	void setLastUsed(uint32 lastUsed) { _lastUsed = lastUsed; }
+
+	/** Sync the archive's index with the index cache, returns false if it can't be cached or is outdated */
+	virtual bool syncIndexCache(Common::Serializer &serializer);
+
 protected:
+	struct ResourceEntry {
+		Common::String fileName;
+		uint32 offset;
+		uint32 size;
+	};
+
+	typedef Common::HashMap<Common::String, uint32, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> EntryMap;
+
 	bool _isIndexed;
 	Common::String _fileName;
+
+	uint32 _lastUsed;
+
+	/** All resources found in this archive. */
+	Common::Array<ResourceEntry> _resources;
+	/** Maps a resource name to its position in _resources. */
+	EntryMap _entryMap;
+
+	/** Make the resource at this position in _resources findable by name. */
+	void mapEntry(uint32 n);
+	/** Find a resource of this archive by name, returns 0 if not found. */
+	const ResourceEntry *findEntry(const Common::String &fileName) const;
+	/** Forget about all resources of this archive. */
+	void clearEntries();
+
+	/** Read a whole file into memory. */
+	static ArchiveDataPtr mapFile(Common::SeekableReadStream &file);
+	/** Create a stream reading directly from a part of the archive data. */
+	static Common::SeekableReadStream *createDataStream(ArchiveDataPtr data, uint32 offset, uint32 size);
 };
 
 class GlueArchive : public Archive {
 public:
-	GlueArchive();
+	GlueArchive(bool mapped = false);
 	~GlueArchive();
 
 	bool open(const Common::String &fileName, Archive *parentArchive = 0);
 	void index(ResourceMap &map);
 	Common::SeekableReadStream *getStream(const Common::String &fileName);
+	bool getData(const Common::String &fileName, ArchiveDataPtr &data, uint32 &offset, uint32 &size);
 	void clearUncompressedData();
+	uint32 getUncompressedSize() const;
+	bool syncIndexCache(Common::Serializer &serializer);
 
 private:
-	struct ResourceEntry {
-		Common::String fileName;
-		uint32 offset;
-		uint32 size;
-	};
+	bool _mapped;     ///< Keep an uncompressed glue file in memory?
+	bool _compressed; ///< Is the glue file compressed?
 
-	Common::Array<ResourceEntry> _resources;
+	uint32 _fileSize; ///< Size of the glue file on disk.
 
 	Common::SeekableReadStream *_file;
 
-	/** Uncompress a glue file. */
+	/** The whole uncompressed glue file, if it's held in memory. */
+	ArchiveDataPtr _data;
+
+	/** The compressed glue file, while it's still being uncompressed. */
+	Common::SeekableReadStream *_compressedFile;
+	/** The buffer the glue file is uncompressed into. */
+	byte *_uncompressed;
+	/** Number of bytes already uncompressed. */
+	uint32 _uncompressedSize;
+
+	/** Open the glue file and uncompress or map it, if necessary. */
+	void openData();
+
+	/** Start uncompressing a glue file. */
 	void uncompressGlue();
+	/** Uncompress the glue file up to this offset. */
+	void uncompressGlue(uint32 end);
+	/** Uncompress the next chunk of the glue file, returns false if there is none. */
+	bool uncompressGlueNextChunk();
 	/** Uncompress a compress glue file chunk. */
 	uint32 uncompressGlueChunk(byte *outBuf, const byte *inBuf, int n) const;
 
@@ -107,22 +188,23 @@ private:
 
 class PGFArchive : public Archive {
 public:
-	PGFArchive() : Archive() {}
+	PGFArchive(bool mapped = false) : Archive(), _mapped(mapped) {}
 	~PGFArchive();
 
 	bool open(const Common::String &fileName, Archive *parentArchive = 0);
 	void index(ResourceMap &map);
 	Common::SeekableReadStream *getStream(const Common::String &fileName);
+	bool getData(const Common::String &fileName, ArchiveDataPtr &data, uint32 &offset, uint32 &size);
+	void listResources(Common::Array<Common::String> &names) const;
 
 private:
-	struct ResourceEntry {
-		Common::String fileName;
-		uint32 offset;
-		uint32 size;
-	};
+	bool _mapped; ///< Keep the PGF file in memory?
 
 	Common::File _file;
-	Common::Array<ResourceEntry> _resources;
+
+	/** The whole PGF file, if it's held in memory. */
+	ArchiveDataPtr _data;
+
 	Common::Array<Archive *> _subArchives;
 };
 
@@ -136,14 +218,12 @@ public:
 	Common::SeekableReadStream *getStream(const Common::String &fileName);
 
 private:
-	struct ResourceEntry {
-		Common::String fileName;
-		uint32 offset;
-		uint32 size;
-	};
-
 	Common::SeekableReadStream *_file;
-	Common::Array<ResourceEntry> _resources;
+
+	/** The parent's data the TND file lives in, if it's held in memory. */
+	ArchiveDataPtr _data;
+	/** The offset of the TND file within the parent's data. */
+	uint32 _dataOffset;
 };
 
 class SaturnGlueArchive : public Archive {
@@ -154,16 +234,10 @@ public:
 	bool open(const Common::String &fileName, Archive *parentArchive = 0);
 	void index(ResourceMap &map);
 	Common::SeekableReadStream *getStream(const Common::String &fileName);
+	void listResources(Common::Array<Common::String> &names) const;
 
 private:
-	struct ResourceEntry {
-		Common::String fileName;
-		uint32 offset;
-		uint32 size;
-	};
-
 	Common::File _indexFile, _glueFile;
-	Common::Array<ResourceEntry> _resources;
 	Common::Array<Archive *> _subArchives;
 };
 
@@ -175,6 +249,7 @@ public:
 	bool open(const Common::String &fileName, Archive *parentArchive = 0);
 	void index(ResourceMap &map);
 	Common::SeekableReadStream *getStream(const Common::String &fileName);
+	void listResources(Common::Array<Common::String> &names) const;
 
 private:
 	Common::MacResManager *_resFork;
@@ -191,14 +266,6 @@ public:
 	Common::SeekableReadStream *getStream(const Common::String &fileName);
 
 private:
-	struct ResourceEntry {
-		Common::String fileName;
-		uint32 offset;
-		uint32 size;
-	};
-
-	Common::Array<ResourceEntry> _resources;
-
 	Common::File _file;
 };
 
@@ -212,14 +279,6 @@ public:
 	Common::SeekableReadStream *getStream(const Common::String &fileName);
 
 private:
-	struct ResourceEntry {
-		Common::String fileName;
-		uint32 offset;
-		uint32 size;
-	};
-
-	Common::Array<ResourceEntry> _resources;
-
 	Common::File _file;
 };
 
@@ -233,14 +292,6 @@ public:
 	Common::SeekableReadStream *getStream(const Common::String &fileName);
 
 private:
-	struct ResourceEntry {
-		Common::String fileName;
-		uint32 offset;
-		uint32 size;
-	};
-
-	Common::Array<ResourceEntry> _resources;
-
 	Common::File _file;
 };
 
@@ -265,28 +316,69 @@ public:
 	/** Does a specific resource exist? */
 	bool hasResource(const Common::String &resource);
 
+	/** Get the highest existing frame number of the resources base01.extension to base99.extension. */
+	uint8 getFrameCount(const Common::String &base, const Common::String &extension);
+
 	/** Get a specific resource. */
 	Common::SeekableReadStream *getResource(const Common::String &resource);
 
-	/** Remove the file data from unused compressed archives. */
+	/** Remove the file data from the least recently used compressed archives. */
 	void clearUncompressedData();
 
+	/** Queue a resource to be read ahead of time. */
+	void prefetch(const Common::String &resource);
+	/** Read the next queued resource ahead of time, returns false if there was nothing to do. */
+	bool prefetchNext();
+	/** Read a resource ahead of time right now and get it, without it counting as used. */
+	Common::SeekableReadStream *prefetchResource(const Common::String &resource);
+
 	/** Set the specific game version. */
 	void setGameVersion(GameVersion gameVersion, Common::Language language);
 
 	/** Get the information class about which formats the game uses. */
 	const VersionFormats &getVersionFormats();
 
+	/** Keep uncompressed glue and PGF archives in memory, handing out resources without copying. */
+	void setMapArchives(bool mapArchives);
+
+	/** Set the save file the resource index should be cached in. */
+	void setIndexCache(const Common::String &indexCache);
+
 	static Common::String addExtension(const Common::String &name, const Common::String &extension);
 
 private:
 	VersionFormats _versionFormats;
 
+	/** Keep uncompressed archives in memory? */
+	bool _mapArchives;
+
+	Common::String _indexCache;      ///< Save file the resource index is cached in.
+	Common::String _indexFile;       ///< The resource index file the cache belongs to.
+	uint32         _indexFileSize;   ///< Size of that resource index file.
+	bool           _indexCacheDirty; ///< Does the cache need to be updated?
+
+	uint32 _useCount; ///< Number of resources requested so far.
+
+	typedef Common::HashMap<Common::String, bool, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> PrefetchQueueMap;
+	typedef Common::HashMap<Common::String, ArchiveDataPtr, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> PrefetchMap;
+
+	Common::List<Common::String> _prefetchQueue;  ///< Resources still to be read ahead of time.
+	PrefetchQueueMap             _prefetchQueued; ///< The same resources, to quickly find them.
+	Common::List<Common::String> _prefetchOrder;  ///< Resources read ahead of time, oldest first.
+	PrefetchMap                  _prefetched;     ///< The data of resources read ahead of time.
+	uint32                       _prefetchSize;   ///< Memory held by prefetched resources.
+
 	/** All indexed archives. */
 	Common::Array<Archive *> _archives;
 	/** All indexed resources. */
 	ResourceMap _resources;
 
+	typedef Common::HashMap<Common::String, uint8, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> FrameIndex;
+
+	/** Highest frame number of every numbered resource sequence, by name without the number. */
+	FrameIndex _frameIndex;
+	bool       _frameIndexFiles; ///< Have the plain files been added to the frame index?
+
 	/** Read the index file's header. */
 	bool readIndexHeader(Common::File &indexFile, uint16 &resCount);
 	/** Read the glue file section of the index file. */
@@ -294,6 +386,33 @@ private:
 	/** Read the resources section of the index file. */
 	bool readIndexResources(Common::File &indexFile, uint16 resCount);
 
+	/** Try to recreate the index from the index cache. */
+	bool loadIndexCache();
+	/** Write the index cache, if it changed. */
+	void saveIndexCache();
+	/** Sync the complete index with the index cache. */
+	bool syncIndexCache(Common::Serializer &serializer);
+
+	/** Index an archive, adding its resources to the frame index. */
+	void indexArchive(Archive &archive);
+	/** Add all plain files to the frame index. */
+	void indexFrameFiles();
+	/** Add a resource to the frame index, if its name ends with a frame number. */
+	void addFrame(const Common::String &resource);
+	/** Are the two characters in front of end a frame number? */
+	static bool isFrameNumber(const char *str, const char *end);
+
+	/** Find a resource that was read ahead of time. */
+	ArchiveDataPtr findPrefetched(const Common::String &resource) const;
+	/** Read a resource ahead of time, leaving the archive usage information alone. */
+	ArchiveDataPtr readPrefetched(const Common::String &resource);
+
+	/** Get the archive a resource is in, indexing it if necessary. */
+	Archive *getArchive(const Common::String &resource);
+
+	/** Clear uncompressed data of the least recently used archives until it fits into the budget. */
+	void trimUncompressedData(Archive *keep);
+
 	/** Add a Mac resource fork. */
 	bool addMacResourceFork(const Common::String &fileName, uint32 type);
 	/** Add a Mac room archive */
@@ -34,6 +34,7 @@
 #include "engines/darkseed2/roomconfig.h"
 #include "engines/darkseed2/script.h"
 #include "engines/darkseed2/sprite.h"
+#include "engines/darkseed2/spritecache.h"
 #include "engines/darkseed2/graphicalobject.h"
 #include "engines/darkseed2/saveload.h"
 
@@ -77,6 +78,9 @@ void Room::clear() {
 	// Remove all local variables
 	_variables->clearLocal();
 
+	if (!_name.empty())
+		reportMemoryUsage();
+
 	_name.clear();
 	_roomFile.clear();
 	_objsFile.clear();
@@ -108,6 +112,28 @@ void Room::clear() {
 		delete it->_value;
 
 	_animations.clear();
+
+	// Release the frames only this room used
+	SprCache.trim();
+
+	_exits.clear();
+}
+
+void Room::reportMemoryUsage() const {
+	uint32 backgroundSize = 0;
+	if (_background)
+		backgroundSize += _background->getMemorySize();
+	if (_walkMap)
+		backgroundSize += _walkMap->getMemorySize();
+
+	uint32 animationSize = 0;
+	for (AnimationMap::const_iterator it = _animations.begin(); it != _animations.end(); ++it)
+		animationSize += it->_value->getMemorySize();
+
+	debugC(1, kDebugRooms, "Room \"%s\" sprite memory: %d bytes background, %d bytes in %d animations "
+			"(%d bytes in %d shared sprites, %d bytes converted lazily overall)", _name.c_str(),
+			backgroundSize, animationSize, _animations.size(), SprCache.getMemorySize(),
+			SprCache.getCount(), Sprite::getLazyMemorySize());
 }
 
 const Common::String &Room::getName() const {
@@ -399,6 +425,8 @@ bool Room::setup(Resources &resources) {
 	if (!loadSprites(resources))
 		return false;
 
+	findExits();
+
 	_ready = true;
 
 	return true;
@@ -408,6 +436,95 @@ void Room::init() {
 	_confMan->initRoom();
 }
 
+void Room::findExits() {
+	_exits.clear();
+
+	for (uint i = 0; i < _objects.size(); i++) {
+		for (int j = 0; j < kObjectVerbNone; j++) {
+			const Common::List<ScriptChunk *> &scripts = _objects[i].getScripts((ObjectVerb) j);
+
+			for (Common::List<ScriptChunk *>::const_iterator it = scripts.begin(); it != scripts.end(); ++it)
+				findExits(**it);
+		}
+	}
+
+	for (Common::List<ScriptChunk *>::const_iterator it = _entryScripts.begin(); it != _entryScripts.end(); ++it)
+		findExits(**it);
+
+	debugC(2, kDebugRooms, "Room \"%s\" has %d exits", _name.c_str(), _exits.size());
+}
+
+void Room::findExits(const ScriptChunk &script) {
+	const Common::Array<ScriptChunk::Action> &actions = script.getActions();
+
+	for (Common::Array<ScriptChunk::Action>::const_iterator it = actions.begin(); it != actions.end(); ++it) {
+		if (it->action != kScriptActionXYRoom)
+			continue;
+
+		const Common::Array<int32> &args = it->ints;
+		if (args[2] == 0)
+			continue;
+
+		Common::String exit = Common::String::format("%04d", args[2]);
+		if (exit == _name)
+			continue;
+
+		bool known = false;
+		for (Common::List<Common::String>::const_iterator e = _exits.begin(); e != _exits.end(); ++e)
+			if (*e == exit)
+				known = true;
+
+		if (!known)
+			_exits.push_back(exit);
+	}
+}
+
+void Room::prefetch(Resources &resources) {
+	// Only one resource at a time, so that we're not stalling
+	if (resources.prefetchNext())
+		return;
+
+	if (_exits.empty())
+		return;
+
+	Common::String exit = _exits.front();
+	_exits.pop_front();
+
+	prefetchRoom(resources, exit);
+}
+
+void Room::prefetchRoom(Resources &resources, const Common::String &base) {
+	Common::String room    = Resources::addExtension("ROOM" + base, "DAT");
+	Common::String objects = Resources::addExtension("OBJ_" + base, "DAT");
+
+	if (!resources.hasResource(room) || !resources.hasResource(objects))
+		return;
+
+	debugC(2, kDebugRooms, "Prefetching room \"%s\"", base.c_str());
+
+	const VersionFormats &formats = resources.getVersionFormats();
+
+	// We need to look into the room file to know its images, so keep what we read
+	Common::SeekableReadStream *resRoom = resources.prefetchResource(room);
+	DATFile roomParser(room, *resRoom);
+	delete resRoom;
+
+	resources.prefetch(objects);
+
+	const Common::String *cmd, *args;
+	while (roomParser.nextLine(cmd, args)) {
+		if (cmd->equalsIgnoreCase("BackDrop")) {
+			resources.prefetch(Resources::addExtension(*args,
+					formats.getImageExtension(formats.getRoomImageType())));
+		} else if (cmd->equalsIgnoreCase("WalkMap")) {
+			if (formats.getWalkMapType() == kWalkMapTypeBMP)
+				resources.prefetch(Resources::addExtension(DATFile::argGet(*args, 0),
+						formats.getImageExtension(formats.getImageType())));
+		} else if (cmd->equalsIgnoreCase("EndID"))
+			break;
+	}
+}
+
 Animation *Room::loadAnimation(Resources &resources, const Common::String &base) {
 	if (_animations.contains(base))
 		return _animations.getVal(base);
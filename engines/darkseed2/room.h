@@ -96,6 +96,9 @@ public:
 	/** Initialize the room after parsing. */
 	void init();
 
+	/** Read a bit of the rooms we might go to next ahead of time. */
+	void prefetch(Resources &resources);
+
 protected:
 	bool saveLoad(Common::Serializer &serializer, Resources &resources);
 	bool loading(Resources &resources);
@@ -137,6 +140,9 @@ private:
 	/** All animations. */
 	AnimationMap _animations;
 
+	/** Rooms this room's scripts can lead to, and that weren't prefetched yet. */
+	Common::List<Common::String> _exits;
+
 	// For saving/loading
 	Common::List<uint32> _entryScriptLines;
 
@@ -154,8 +160,19 @@ private:
 	/** Load the sprites. */
 	bool loadSprites(Resources &resources);
 
+	/** Print how much memory the room's sprites use. */
+	void reportMemoryUsage() const;
+
 	/** Set up the room after parsing. */
 	bool setup(Resources &resources);
+
+	/** Find all rooms this room's scripts can lead to. */
+	void findExits();
+	/** Find all rooms this script can lead to. */
+	void findExits(const ScriptChunk &script);
+
+	/** Queue a room's resources to be read ahead of time. */
+	static void prefetchRoom(Resources &resources, const Common::String &base);
 };
 
 } // End of namespace DarkSeed2
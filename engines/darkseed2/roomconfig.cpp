@@ -67,8 +67,8 @@ RoomConfig::RoomConfig(Variables &variables) : _variables(&variables) {
 	_state        = false;
 	_stateChanged = false;
 
-	_conditionsState       = false;
-	_conditionsCheckedLast = 0;
+	_conditionsState     = false;
+	_conditionsCheckedAt = 0;
 }
 
 RoomConfig::~RoomConfig() {
@@ -86,6 +86,10 @@ bool RoomConfig::isRunning() const {
 	return _running;
 }
 
+bool RoomConfig::hasChanges() const {
+	return !_changes.empty();
+}
+
 bool RoomConfig::stateChanged() const {
 	return _stateChanged;
 }
@@ -109,10 +113,12 @@ bool RoomConfig::parse(DATFile &dat) {
 			}
 
 			_conditions.push_back(*args);
+			_condition.add(*_variables, *args);
 		} else if (cmd->equalsIgnoreCase("Cond2")) {
 			// A secondary condition
 
 			_conditions.push_back(*args);
+			_condition.add(*_variables, *args);
 		} else if (cmd->equalsIgnoreCase("Change")) {
 			// A variables change set
 
@@ -131,13 +137,19 @@ bool RoomConfig::parse(DATFile &dat) {
 }
 
 bool RoomConfig::conditionsMet() {
-	uint32 changedLast = _variables->getLastChanged();
-	if (changedLast <= _conditionsCheckedLast) {
-		// Nothing changed, return the cached result
+	uint32 changeCount = _variables->getChangeCount();
+	if (changeCount == _conditionsCheckedAt)
+		// Nothing changed at all, return the cached result
+		return _conditionsState;
+
+	// Conditions without variables have version 0, so always evaluate on the first check
+	if ((_conditionsCheckedAt != 0) && (_variables->getVersion(_condition) <= _conditionsCheckedAt)) {
+		// None of the variables we depend on changed, return the cached result
+		_conditionsCheckedAt = changeCount;
 		return _conditionsState;
 	}
 
-	bool met = _variables->evalCondition(_conditions);
+	bool met = _variables->evalCondition(_condition);
 
 	_stateChanged = false;
 	if (_state != met) {
@@ -145,13 +157,21 @@ bool RoomConfig::conditionsMet() {
 		_state = met;
 	}
 
-	_conditionsState       = met;
-	_conditionsCheckedLast = changedLast;
+	_conditionsState     = met;
+	_conditionsCheckedAt = changeCount;
 
 	return _conditionsState;
 }
 
-bool RoomConfig::conditionsMet(const Common::String &cond) {
+bool RoomConfig::isVariableDriven() const {
+	return false;
+}
+
+uint32 RoomConfig::getVersion() const {
+	return _variables->getVersion(_condition);
+}
+
+bool RoomConfig::conditionsMet(const Condition &cond) {
 	return _variables->evalCondition(cond);
 }
 
@@ -208,7 +228,9 @@ bool RoomConfig::saveLoad(Common::Serializer &serializer, Resources &resources)
 }
 
 bool RoomConfig::loading(Resources &resources) {
-	_conditionsCheckedLast = 0;
+	_condition = Condition(*_variables, _conditions);
+
+	_conditionsCheckedAt = 0;
 
 	_state        = false;
 	_stateChanged = false;
@@ -246,6 +268,10 @@ bool RoomConfigMusic::updateStatus() {
 	return applyChanges();
 }
 
+bool RoomConfigMusic::isVariableDriven() const {
+	return true;
+}
+
 bool RoomConfigMusic::parseLine(const Common::String &cmd, const Common::String &args) {
 	if (cmd.equalsIgnoreCase("Midi")) {
 		// Midi music change
@@ -298,6 +324,9 @@ RoomConfigSprite::RoomConfigSprite(Variables &variables, Resources &resources,
 
 	_loopStart = -1;
 	_loopEnd   = -1;
+
+	// An empty condition is always met
+	_loopCondition = Condition(variables, _loopCond);
 }
 
 RoomConfigSprite::~RoomConfigSprite() {
@@ -381,7 +410,7 @@ bool RoomConfigSprite::updateStatus() {
 
 	// Looping
 	if ((_loopEnd > 0) && (_loopStart > 0) && (_curPos > ((uint32) _loopEnd)))
-		if (conditionsMet(_loopCond))
+		if (conditionsMet(_loopCondition))
 			_curPos = _loopStart;
 
 	// SFX playing
@@ -490,6 +519,7 @@ bool RoomConfigSprite::parseLine(const Common::String &cmd, const Common::String
 		// Looping when this condition is met
 
 		_loopCond = args;
+		_loopCondition = Condition(*_variables, args);
 
 	} else if (cmd.equalsIgnoreCase("LoopPoint")) {
 		// Looping start and end index
@@ -690,6 +720,8 @@ bool RoomConfigSprite::saveLoad(Common::Serializer &serializer, Resources &resou
 }
 
 bool RoomConfigSprite::loading(Resources &resources) {
+	_loopCondition = Condition(*_variables, _loopCond);
+
 	_animation = _graphics->getRoom().loadAnimation(*_resources, _anim);
 	if (!_animation)
 		return false;
@@ -725,6 +757,10 @@ bool RoomConfigPalette::updateStatus() {
 	return false;
 }
 
+bool RoomConfigPalette::isVariableDriven() const {
+	return true;
+}
+
 bool RoomConfigPalette::parseLine(const Common::String &cmd, const Common::String &args) {
 	if        (cmd.equalsIgnoreCase("StartIndex")) {
 		// The start index
@@ -791,6 +827,10 @@ bool RoomConfigMirror::updateStatus() {
 	return false;
 }
 
+bool RoomConfigMirror::isVariableDriven() const {
+	return true;
+}
+
 bool RoomConfigMirror::parseLine(const Common::String &cmd, const Common::String &args) {
 	if        (cmd.equalsIgnoreCase("ClipXY")) {
 		// The mirror's area
@@ -911,7 +951,11 @@ bool RoomConfigMirror::loading(Resources &resources) {
 }
 
 
+/** Maximum number of passes over the RoomConfigs within one update. */
+static const uint32 kMaxCascade = 100;
+
 RoomConfigManager::RoomConfigManager(DarkSeed2Engine &vm) : _vm(&vm) {
+	_maxCascade = 0;
 }
 
 RoomConfigManager::~RoomConfigManager() {
@@ -942,16 +986,59 @@ void RoomConfigManager::deinitRoom() {
 }
 
 void RoomConfigManager::updateStatus() {
-	Common::List<RoomConfig *>::iterator it = _configs.begin();
-	while (it != _configs.end()) {
-		if ((*it)->updateStatus()) {
-			it = _configs.begin();
-			continue;
+	// Not updated yet in this tick
+	_updatedAt.resize(_configs.size());
+	for (uint i = 0; i < _updatedAt.size(); i++)
+		_updatedAt[i] = 0;
+
+	uint32 cascade = 0;
+	uint32 updates = 0;
+
+	// When a config changed something, start again at the first config.
+	// Configs that only depend on their conditions' variables are skipped
+	// if they were already updated and none of those variables changed.
+	// Sprites depend on time and their animation state too, so they always run.
+	bool restart = true;
+	while (restart) {
+		restart = false;
+
+		uint i = 0;
+		for (Common::List<RoomConfig *>::iterator it = _configs.begin(); it != _configs.end(); ++it, i++) {
+			if ((*it)->isVariableDriven() && (_updatedAt[i] != 0) && ((*it)->getVersion() <= _updatedAt[i]))
+				continue;
+
+			_updatedAt[i] = _vm->_variables->getChangeCount();
+			updates++;
+
+			if ((*it)->updateStatus()) {
+				restart = true;
+				break;
+			}
+		}
+
+		if (restart && (++cascade >= kMaxCascade)) {
+			warning("RoomConfigManager::updateStatus(): Cascade didn't settle after %d passes", cascade);
+			break;
 		}
-		++it;
+	}
+
+	if (cascade > 0)
+		debugC(4, kDebugRoomConf, "RoomConfigManager: Cascade depth %d, %d updates", cascade, updates);
+
+	if (cascade > _maxCascade) {
+		_maxCascade = cascade;
+		debugC(1, kDebugRoomConf, "RoomConfigManager: New deepest cascade, depth %d", cascade);
 	}
 }
 
+bool RoomConfigManager::isChanging() const {
+	for (Common::List<RoomConfig *>::const_iterator it = _configs.begin(); it != _configs.end(); ++it)
+		if ((*it)->isRunning() && (*it)->hasChanges())
+			return true;
+
+	return false;
+}
+
 bool RoomConfigManager::parseConfig(DATFile &dat) {
 	const Common::String *cmd, *args;
 	while (dat.nextLine(cmd, args)) {
@@ -998,6 +1085,9 @@ void RoomConfigManager::clear() {
 		delete *it;
 
 	_configs.clear();
+	_updatedAt.clear();
+
+	_maxCascade = 0;
 }
 
 bool RoomConfigManager::parseConfigs(DATFile &dat, RoomConfig::Type type) {
@@ -34,6 +34,7 @@
 #include "engines/darkseed2/darkseed2.h"
 #include "engines/darkseed2/saveable.h"
 #include "engines/darkseed2/graphics.h"
+#include "engines/darkseed2/variables.h"
 
 namespace DarkSeed2 {
 
@@ -67,6 +68,8 @@ public:
 	bool isLoaded()  const;
 	/** Is the RoomConfig running? */
 	bool isRunning() const;
+	/** Does the RoomConfig change variables? */
+	bool hasChanges() const;
 
 	/** Has the conditions state changed? */
 	bool stateChanged() const;
@@ -79,13 +82,20 @@ public:
 	/** Check for status changes and run the RoomConfig if possible. */
 	virtual bool updateStatus() = 0;
 
+	/** Does updateStatus() only depend on the variables read by the conditions? */
+	virtual bool isVariableDriven() const;
+	/** Get the change count of the last change to any variable the conditions read. */
+	uint32 getVersion() const;
+
 protected:
 	Type _type; ///< The specific config type.
 
+	Variables *_variables;
+
 	/** Are the conditions to run the RoomConfig met? */
 	bool conditionsMet();
 	/** Are these conditions met? */
-	bool conditionsMet(const Common::String &cond);
+	bool conditionsMet(const Condition &cond);
 
 	/** Enter the running state. */
 	void run();
@@ -109,8 +119,6 @@ protected:
 	bool loading(Resources &resources);
 
 private:
-	Variables *_variables;
-
 	bool _loaded;  ///< Is the RoomConfig loaded and ready to run?
 	bool _running; ///< Is the RoomConfig running?
 
@@ -122,11 +130,13 @@ private:
 	bool _stateChanged; ///< Conditions state changed.
 
 	// For caching purposes
-	bool   _conditionsState;       ///< The last remembered conditions state.
-	uint32 _conditionsCheckedLast; ///< When were the conditions checked last?
+	bool   _conditionsState;     ///< The last remembered conditions state.
+	uint32 _conditionsCheckedAt; ///< Variables change count when the conditions were checked last.
 
 	/** The conditions required for this RoomConfig. */
 	Common::List<Common::String> _conditions;
+	/** The compiled conditions. */
+	Condition _condition;
 	/** The variables change set to be applied once the RoomConfig finished. */
 	Common::List<Common::String> _changes;
 };
@@ -141,6 +151,8 @@ public:
 
 	bool updateStatus();
 
+	bool isVariableDriven() const;
+
 	bool parseLine(const Common::String &cmd, const Common::String &args);
 
 protected:
@@ -209,6 +221,7 @@ private:
 
 	// Looping
 	Common::String _loopCond;  ///< Looping while this condition is true.
+	Condition _loopCondition;  ///< The compiled looping condition.
 	int32          _loopStart; ///< Looping sequence starts here.
 	int32          _loopEnd;   ///< Looping sequence ends here.
 
@@ -244,6 +257,8 @@ public:
 
 	bool updateStatus();
 
+	bool isVariableDriven() const;
+
 	bool parseLine(const Common::String &cmd, const Common::String &args);
 
 protected:
@@ -268,6 +283,8 @@ public:
 
 	bool updateStatus();
 
+	bool isVariableDriven() const;
+
 	bool parseLine(const Common::String &cmd, const Common::String &args);
 
 protected:
@@ -299,6 +316,9 @@ public:
 
 	void updateStatus();
 
+	/** Is any running RoomConfig going to change variables? */
+	bool isChanging() const;
+
 	bool parseConfig(DATFile &dat);
 
 	RoomConfig *createRoomConfig(RoomConfig::Type type);
@@ -312,6 +332,11 @@ private:
 
 	Common::List<RoomConfig *> _configs;
 
+	/** Variables change count at each config's last update within the current tick. */
+	Common::Array<uint32> _updatedAt;
+
+	uint32 _maxCascade; ///< Deepest cascade of updates seen in this room.
+
 	void clear();
 
 	bool parseConfigs(DATFile &dat, RoomConfig::Type type);
@@ -131,6 +131,29 @@ ScriptChunk::Action::Action(ScriptAction act, const Common::String &args) {
 	arguments = args;
 }
 
+ScriptChunk::Action::Action(const Variables &variables, ScriptAction act, const Common::String &args) {
+	action    = act;
+	arguments = args;
+
+	// Decode the arguments now, so that the interpreter doesn't need to on every execution
+	if        (action == kScriptActionXYRoom) {
+		ints = DATFile::argGetInts(arguments, 5);
+	} else if (action == kScriptActionFrom) {
+		ints = DATFile::argGetInts(arguments, 3);
+	} else if (action == kScriptActionAnim) {
+		Common::Array<Common::String> lArgs = DATFile::argGet(arguments);
+		if (lArgs.size() >= 5) {
+			ints.push_back(atoi(lArgs[0].c_str()));
+			ints.push_back(atoi(lArgs[1].c_str()));
+			name = lArgs[4];
+		}
+	} else if (action == kScriptActionChange) {
+		changes.add(variables, arguments);
+	} else if (action == kScriptActionWaitUntil) {
+		condition.add(variables, arguments);
+	}
+}
+
 
 ScriptChunk::ScriptChunk(const Variables &variables, ScriptRegister &scriptRegister) {
 	_variables = &variables;
@@ -139,6 +162,8 @@ ScriptChunk::ScriptChunk(const Variables &variables, ScriptRegister &scriptRegis
 
 	_ready = false;
 	_from  = 0;
+
+	_curPos = 0;
 }
 
 ScriptChunk::~ScriptChunk() {
@@ -150,7 +175,7 @@ bool ScriptChunk::atEnd() const {
 	if (!_ready)
 		return true;
 
-	return _curPos == _actions.end();
+	return _curPos >= _actions.size();
 }
 
 uint32 ScriptChunk::getFrom() const {
@@ -162,31 +187,27 @@ void ScriptChunk::next() {
 		return;
 
 	++_curPos;
-	++_curPosNumber;
 }
 
 void ScriptChunk::rewind() {
 	if (!_ready)
 		return;
 
-	_curPos       = _actions.begin();
-	_curPosNumber = 0;
+	_curPos = 0;
 }
 
 void ScriptChunk::seekEnd() {
 	if (!_ready)
 		return;
 
-	_curPos       = _actions.end();
-	_curPosNumber = _actions.size();
+	_curPos = _actions.size();
 }
 
 void ScriptChunk::seekTo(uint32 n) {
-	if (n < _curPosNumber)
-		rewind();
+	if (!_ready)
+		return;
 
-	while (!atEnd() && (_curPosNumber != n))
-		next();
+	_curPos = MIN<uint32>(n, _actions.size());
 }
 
 const Common::String &ScriptChunk::getSignature() const {
@@ -194,7 +215,7 @@ const Common::String &ScriptChunk::getSignature() const {
 }
 
 uint32 ScriptChunk::getCurLine() const {
-	return _curPosNumber;
+	return _curPos;
 }
 
 void ScriptChunk::clear() {
@@ -207,6 +228,8 @@ void ScriptChunk::clear() {
 	_signature.clear();
 	_conditions.clear();
 	_actions.clear();
+
+	_curPos = 0;
 }
 
 bool ScriptChunk::parse(DATFile &dat) {
@@ -228,10 +251,10 @@ bool ScriptChunk::parse(DATFile &dat) {
 			}
 
 			// A primary condition
-			_conditions.push_back(*arg);
+			_conditions.add(*_variables, *arg);
 		} else if (cmd->equalsIgnoreCase("Cond2")) {
 			// A secondary condition
-			_conditions.push_back(*arg);
+			_conditions.add(*_variables, *arg);
 		} else if (cmd->matchString("*End", true)) {
 			// Reached the end of the current verb section
 			dat.previous();
@@ -262,7 +285,7 @@ bool ScriptChunk::parse(DATFile &dat) {
 				parseFrom(*arg);
 
 			// Put the action into our list
-			_actions.push_back(Action(action, *arg));
+			_actions.push_back(Action(*_variables, action, *arg));
 		}
 	}
 
@@ -286,11 +309,11 @@ bool ScriptChunk::conditionsMet() const {
 	return _variables->evalCondition(_conditions);
 }
 
-const Common::List<Common::String> &ScriptChunk::getConditions() const {
+const Condition &ScriptChunk::getConditions() const {
 	return _conditions;
 }
 
-const Common::List<ScriptChunk::Action> &ScriptChunk::getActions() const {
+const Common::Array<ScriptChunk::Action> &ScriptChunk::getActions() const {
 	return _actions;
 }
 
@@ -298,7 +321,7 @@ const ScriptChunk::Action &ScriptChunk::getAction() const {
 	if (atEnd())
 		return invalidAction;
 
-	return *_curPos;
+	return _actions[_curPos];
 }
 
 ScriptAction ScriptChunk::parseScriptAction(const Common::String &action) {
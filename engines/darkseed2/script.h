@@ -27,10 +27,12 @@
 #define DARKSEED2_SCRIPT_H
 
 #include "common/str.h"
+#include "common/array.h"
 #include "common/list.h"
 
 #include "engines/darkseed2/darkseed2.h"
 #include "engines/darkseed2/saveable.h"
+#include "engines/darkseed2/variables.h"
 
 namespace Common {
 	class SeekableReadStream;
@@ -115,7 +117,14 @@ public:
 		ScriptAction action;      ///< The action.
 		Common::String arguments; ///< The arguments.
 
+		// The arguments, decoded when parsing for the actions that need them
+		Common::Array<int32> ints;      ///< Numerical arguments (XYRoom, Anim, From).
+		Common::String       name;      ///< The movie file (Anim).
+		Condition            condition; ///< The condition waited for (WaitUntil).
+		ChangeSet            changes;   ///< The variables change set (Change).
+
 		Action(ScriptAction act, const Common::String &args);
+		Action(const Variables &variables, ScriptAction act, const Common::String &args);
 	};
 
 	ScriptChunk(const Variables &variables, ScriptRegister &scriptRegister);
@@ -152,10 +161,10 @@ public:
 	bool conditionsMet() const;
 
 	/** Get the script conditions. */
-	const Common::List<Common::String> &getConditions() const;
+	const Condition &getConditions() const;
 
 	/** Get all script actions. */
-	const Common::List<Action> &getActions() const;
+	const Common::Array<Action> &getActions() const;
 
 	/** Return the current action. */
 	const Action &getAction() const;
@@ -168,7 +177,7 @@ public:
 	ScriptRegister *_scriptRegister;
 
 	/** The conditions required for this script. */
-	Common::List<Common::String> _conditions;
+	Condition _conditions;
 
 	/** The script file's signature. */
 	Common::String _signature;
@@ -179,12 +188,10 @@ public:
 	uint32 _from; ///< The "from" room flag.
 
 	/** All actions. */
-	Common::List<Action> _actions;
+	Common::Array<Action> _actions;
 
-	/** The current position within the actions. */
-	Common::List<Action>::iterator _curPos;
-	/** The current position's number within the actions. */
-	uint32 _curPosNumber;
+	/** The index of the current action. */
+	uint32 _curPos;
 
 	/** Parse a script action string. */
 	static ScriptAction parseScriptAction(const Common::String &action);
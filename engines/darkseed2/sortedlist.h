@@ -27,13 +27,17 @@
 #define DARKSEED2_SORTEDLIST_H
 
 #include "common/list.h"
+#include "common/array.h"
 
-/** A list that always keeps its elements sorted. */
+/** A list that always keeps its elements sorted.
+ *
+ *  Elements that compare equal are grouped together, and each group
+ *  is indexed in a sorted array. Finding the insertion point is then
+ *  a binary search over the groups instead of a walk over the whole
+ *  list. Iterators stay valid until their element is erased.
+ */
 template<typename t_T>
 class SortedList {
-private:
-	Common::List<t_T> _list;
-
 public:
 	typedef typename Common::List<t_T>::iterator iterator;
 	typedef typename Common::List<t_T>::const_iterator const_iterator;
@@ -44,6 +48,7 @@ public:
 
 	void clear() {
 		_list.clear();
+		_groups.clear();
 	}
 
 	bool empty() const {
@@ -67,28 +72,87 @@ public:
 	}
 
 	iterator erase(iterator pos) {
-		return _list.erase(pos);
+		uint n = findGroup(*pos);
+		assert((n < _groups.size()) && !(*pos < *_groups[n].first));
+
+		Group &group = _groups[n];
+
+		bool first = (group.first == pos);
+
+		iterator next = _list.erase(pos);
+
+		if (--group.count == 0)
+			_groups.remove_at(n);
+		else if (first)
+			group.first = next;
+
+		return next;
 	}
 
 	iterator insert(const t_T &element) {
-		if (_list.empty()) {
-			_list.push_back(element);
-			return _list.begin();
-		}
+		uint n = findGroup(element);
+
+		if ((n < _groups.size()) && !(element < *_groups[n].first)) {
+			// Already got elements equal to this one, put it in front of them
+
+			Group &group = _groups[n];
+
+			iterator pos = group.first;
+
+			_list.insert(pos, element);
+			pos--;
+
+			group.first = pos;
+			group.count++;
 
-		iterator pos = _list.begin();
-		for (pos = _list.begin(); pos != _list.end(); ++pos) {
-			if (!(*pos < element))
-				break;
+			return group.first;
 		}
 
-		_list.insert(pos, element);
+		// Start a new group, in front of the next bigger one
+
+		iterator pos = (n < _groups.size()) ? _groups[n].first : _list.end();
 
+		_list.insert(pos, element);
 		pos--;
 
-		return pos;
+		Group group;
+
+		group.first = pos;
+		group.count = 1;
+
+		_groups.insert_at(n, group);
+
+		return group.first;
 	}
 
+private:
+	/** A group of elements that compare equal. */
+	struct Group {
+		iterator first; ///< The group's first element.
+		uint     count; ///< Number of elements in the group.
+	};
+
+	Common::List<t_T> _list;
+
+	/** All groups, sorted. */
+	Common::Array<Group> _groups;
+
+	/** Find the first group not smaller than the element. */
+	uint findGroup(const t_T &element) {
+		uint low  = 0;
+		uint high = _groups.size();
+
+		while (low < high) {
+			uint mid = (low + high) / 2;
+
+			if (*_groups[mid].first < element)
+				low = mid + 1;
+			else
+				high = mid;
+		}
+
+		return low;
+	}
 };
 
 #endif // DARKSEED2_SORTEDLIST_H
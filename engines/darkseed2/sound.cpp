@@ -223,6 +223,14 @@ bool Sound::setSoundVar(int id, const Common::String &soundVar) {
 	return false;
 }
 
+bool Sound::hasSoundVars() const {
+	for (int i = 0; i < kChannelCount; i++)
+		if ((_channels[i].id != -1) && !_channels[i].soundVar.empty())
+			return true;
+
+	return false;
+}
+
 void Sound::updateStatus() {
 	for (int i = 0; i < kChannelCount; i++) {
 		SoundChannel &channel = _channels[i];
@@ -72,6 +72,8 @@ public:
 
 	/** Set the sound variable of playing sound with the given ID. */
 	bool setSoundVar(int id, const Common::String &soundVar);
+	/** Will any sound still change its sound variable when it ends? */
+	bool hasSoundVars() const;
 
 	/** Signal that a speech has ended. */
 	void signalSpeechEnd(int id);
@@ -24,12 +24,15 @@
  */
 
 #include "common/serializer.h"
+#include "common/debug-channels.h"
 
 #include "graphics/surface.h"
 #include "graphics/fontman.h"
 #include "graphics/font.h"
 
+#include "engines/darkseed2/darkseed2.h"
 #include "engines/darkseed2/sprite.h"
+#include "engines/darkseed2/spritecache.h"
 #include "engines/darkseed2/imageconverter.h"
 #include "engines/darkseed2/resources.h"
 #include "engines/darkseed2/cursors.h"
@@ -37,13 +40,94 @@
 
 namespace DarkSeed2 {
 
+const Sprite *Sprite::_lazyFirst      = 0;
+const Sprite *Sprite::_lazyLast       = 0;
+uint32        Sprite::_lazyMemorySize = 0;
+
+/** Number of scaling values to keep source index tables for. */
+static const int kScaleTableCount = 4;
+
+/** The source pixel index of every destination pixel index, for one scaling value. */
+struct ScaleTable {
+	frac_t scaleInverse;
+	Common::Array<int32> indices;
+};
+
+static ScaleTable _scaleTables[kScaleTableCount];
+static int        _scaleTableNext = 0;
+
+/** Get the source indices of the first count destination pixels when scaling by scaleInverse.
+ *  The table stays valid until the next call.
+ */
+static const int32 *getScaleTable(frac_t scaleInverse, int32 count) {
+	ScaleTable *table = 0;
+
+	for (int i = 0; i < kScaleTableCount; i++) {
+		if (!_scaleTables[i].indices.empty() && (_scaleTables[i].scaleInverse == scaleInverse)) {
+			table = &_scaleTables[i];
+			break;
+		}
+	}
+
+	if (!table) {
+		// Replace the oldest table
+		table = &_scaleTables[_scaleTableNext];
+		_scaleTableNext = (_scaleTableNext + 1) % kScaleTableCount;
+
+		table->scaleInverse = scaleInverse;
+		table->indices.clear();
+	}
+
+	if ((int32) table->indices.size() < count) {
+		table->indices.resize(count);
+
+		frac_t pos = 0;
+		int32 index = 0;
+		for (int32 i = 0; i < count; i++) {
+			table->indices[i] = index;
+
+			pos += scaleInverse;
+			while (pos >= ((frac_t) FRAC_ONE)) {
+				index++;
+				pos -= FRAC_ONE;
+			}
+		}
+	}
+
+	return &table->indices[0];
+}
+
+/** Transparency values of a source row, shared by all blits. */
+static Common::Array<uint8> _rowTransparency;
+
+/** Get a buffer for the transparency values of count source pixels.
+ *  The buffer stays valid until the next call.
+ */
+static uint8 *getRowTransparency(int32 count) {
+	if ((int32) _rowTransparency.size() < count)
+		_rowTransparency.resize(count);
+
+	return &_rowTransparency[0];
+}
+
 Sprite::Sprite() {
+	_lazy = false;
+
+	_lazyPrev = 0;
+	_lazyNext = 0;
+
 	clearData();
 }
 
 Sprite::Sprite(const Sprite &sprite) : Saveable(sprite) {
 	_transparencyMap = 0;
 
+	_lazy       = false;
+	_lazyCached = false;
+
+	_lazyPrev = 0;
+	_lazyNext = 0;
+
 	copyFrom(sprite);
 }
 
@@ -59,18 +143,33 @@ Sprite &Sprite::operator=(const Sprite &sprite) {
 void Sprite::copyFrom(const Sprite &sprite) {
 	discard();
 
+	// The true color data of a lazy sprite is recreated when the copy is drawn
 	if (sprite._surfacePaletted.pixels) {
 		_surfacePaletted.copyFrom(sprite._surfacePaletted);
 
-		_transparencyMap = new uint8[_surfacePaletted.w * _surfacePaletted.h];
-		memcpy(_transparencyMap, sprite._transparencyMap, _surfacePaletted.w * _surfacePaletted.h);
+		if (!sprite._lazyCached) {
+			_transparencyMap = new uint8[_surfacePaletted.w * _surfacePaletted.h];
+			memcpy(_transparencyMap, sprite._transparencyMap, _surfacePaletted.w * _surfacePaletted.h);
+		}
 	}
 
-	if (sprite._surfaceTrueColor.pixels)
+	if (sprite._surfaceTrueColor.pixels && !sprite._lazyCached)
 		_surfaceTrueColor.copyFrom(sprite._surfaceTrueColor);
 
+	_lazy       = sprite._lazy;
+	_lazyCached = sprite._lazyCached;
+
 	_palette = sprite._palette;
 
+	copyProperties(sprite);
+
+	_scale        = sprite._scale;
+	_scaleInverse = sprite._scaleInverse;
+
+	_shared = sprite._shared;
+}
+
+void Sprite::copyProperties(const Sprite &sprite) {
 	_fileName = sprite._fileName;
 	_fromCursor = sprite._fromCursor;
 
@@ -82,12 +181,11 @@ void Sprite::copyFrom(const Sprite &sprite) {
 
 	_flippedHorizontally = sprite._flippedHorizontally;
 	_flippedVertically   = sprite._flippedVertically;
-
-	_scale        = sprite._scale;
-	_scaleInverse = sprite._scaleInverse;
 }
 
 void Sprite::copyFrom(const byte *sprite, uint8 bpp, bool system) {
+	prepareChange();
+
 	if (bpp == 1) {
 		memcpy(_surfacePaletted.pixels, sprite, _surfacePaletted.w * _surfacePaletted.h);
 		memset(_transparencyMap, 0, _surfacePaletted.w * _surfacePaletted.h);
@@ -101,21 +199,25 @@ void Sprite::copyFrom(const byte *sprite, uint8 bpp, bool system) {
 }
 
 bool Sprite::exists() const {
-	return _surfacePaletted.pixels != 0;
+	return getImage()._surfacePaletted.pixels != 0;
 }
 
 int32 Sprite::getWidth(bool unscaled) const {
+	const int32 width = getImage()._surfacePaletted.w;
+
 	if (unscaled || (_scale == FRAC_ONE))
-		return _surfacePaletted.w;
+		return width;
 
-	return fracToInt(_surfacePaletted.w * _scale);
+	return fracToInt(width * _scale);
 }
 
 int32 Sprite::getHeight(bool unscaled) const {
+	const int32 height = getImage()._surfacePaletted.h;
+
 	if (unscaled || (_scale == FRAC_ONE))
-		return _surfacePaletted.h;
+		return height;
 
-	return fracToInt(_surfacePaletted.h * _scale);
+	return fracToInt(height * _scale);
 }
 
 int32 Sprite::getDefaultX(bool unscaled) const {
@@ -147,26 +249,66 @@ int32 Sprite::getFeetY(bool unscaled) const {
 }
 
 Common::Rect Sprite::getArea(bool unscaled) const {
-	if (unscaled || (_scale == FRAC_ONE))
-		return Common::Rect(_surfacePaletted.w, _surfacePaletted.h);
-
-	return Common::Rect(getWidth(), getHeight());
+	return Common::Rect(getWidth(unscaled), getHeight(unscaled));
 }
 
 const ::Graphics::Surface &Sprite::getPaletted() const {
-	return _surfacePaletted;
+	return getImage()._surfacePaletted;
 }
 
 const ::Graphics::Surface &Sprite::getTrueColor() const {
+	if (_shared)
+		return _shared->getTrueColor();
+
+	convertLazy();
+
 	return _surfaceTrueColor;
 }
 
 void Sprite::setPalette(const Palette &palette) {
+	unshare();
+
 	_palette = palette;
 }
 
 const Palette &Sprite::getPalette() const {
-	return _palette;
+	return getImage()._palette;
+}
+
+const Sprite &Sprite::getImage() const {
+	if (_shared)
+		return *_shared;
+
+	return *this;
+}
+
+void Sprite::share(const SpritePtr &sprite) {
+	// The image data comes from that sprite, only the scaling is our own
+	frac_t scale        = _scale;
+	frac_t scaleInverse = _scaleInverse;
+
+	discard();
+	copyProperties(*sprite);
+
+	_scale        = scale;
+	_scaleInverse = scaleInverse;
+
+	_shared = sprite;
+}
+
+void Sprite::unshare() {
+	if (!_shared)
+		return;
+
+	SpritePtr shared = _shared;
+
+	frac_t scale        = _scale;
+	frac_t scaleInverse = _scaleInverse;
+
+	copyFrom(*shared);
+
+	_scale        = scale;
+	_scaleInverse = scaleInverse;
 }
 
 void Sprite::create(int32 width, int32 height) {
@@ -184,6 +326,8 @@ void Sprite::create(int32 width, int32 height) {
 }
 
 void Sprite::discard() {
+	dropLazy();
+
 	_surfacePaletted.free();
 	_surfaceTrueColor.free();
 
@@ -195,10 +339,18 @@ void Sprite::discard() {
 void Sprite::clearData() {
 	_fileName.clear();
 
+	_shared.reset();
+
 	_fromCursor = false;
 
 	_transparencyMap = 0;
 
+	_lazyCached = false;
+
+	_spans.clear();
+	_spanRows.clear();
+	_spansValid = false;
+
 	_defaultX = 0;
 	_defaultY = 0;
 	_feetX    = 0;
@@ -213,7 +365,7 @@ void Sprite::clearData() {
 	_palette.clear();
 }
 
-void Sprite::convertToTrueColor(bool system) {
+void Sprite::convertToTrueColor(bool system) const {
 	if (!exists())
 		return;
 
@@ -223,10 +375,149 @@ void Sprite::convertToTrueColor(bool system) {
 		ImgConv.convert8bit(_surfaceTrueColor, _surfacePaletted, _palette);
 }
 
-void Sprite::createTransparencyMap() {
+uint32 Sprite::getTrueColorMemorySize() const {
+	uint32 size = 0;
+
+	if (_surfaceTrueColor.pixels)
+		size += _surfaceTrueColor.pitch * _surfaceTrueColor.h;
+	if (_transparencyMap)
+		size += _surfacePaletted.w * _surfacePaletted.h;
+
+	return size;
+}
+
+uint32 Sprite::getMemorySize() const {
+	return _surfacePaletted.pitch * _surfacePaletted.h + getTrueColorMemorySize() +
+	       _spans.size() * sizeof(Span) + _spanRows.size() * sizeof(uint32);
+}
+
+uint32 Sprite::getLazyMemorySize() {
+	return _lazyMemorySize;
+}
+
+void Sprite::setLazy(bool lazy) {
+	_lazy = lazy;
+
+	if (!_lazy)
+		prepareChange();
+}
+
+void Sprite::createTrueColor() {
+	if (_lazy && !_palette.empty()) {
+		// Wait with the conversion until the sprite is actually drawn
+		_surfaceTrueColor.free();
+
+		delete[] _transparencyMap;
+		_transparencyMap = 0;
+
+		_lazyCached = true;
+		return;
+	}
+
+	createTransparencyMap();
+	convertToTrueColor();
+}
+
+void Sprite::convertLazy() const {
+	if (!_lazyCached)
+		return;
+
+	if (_surfaceTrueColor.pixels) {
+		// Already converted, just mark it as the most recently drawn
+		unlinkLazy();
+		linkLazy();
+		return;
+	}
+
+	_surfaceTrueColor.create(_surfacePaletted.w, _surfacePaletted.h, 2);
+
+	convertToTrueColor();
+
+	// Drawing the sprite only needs the spans, not the whole transparency map
+	if (!_spansValid) {
+		_transparencyMap = new uint8[_surfacePaletted.w * _surfacePaletted.h];
+
+		createTransparencyMap();
+		createSpans();
+
+		delete[] _transparencyMap;
+		_transparencyMap = 0;
+	}
+
+	linkLazy();
+	_lazyMemorySize += getTrueColorMemorySize();
+
+	// Drop the least recently drawn lazy sprites until we're within the budget again
+	while ((_lazyMemorySize > kLazyBudget) && (_lazyFirst != this))
+		_lazyFirst->dropLazy();
+}
+
+void Sprite::dropLazy() const {
+	if (!_lazyCached || !_surfaceTrueColor.pixels)
+		return;
+
+	unlinkLazy();
+	_lazyMemorySize -= getTrueColorMemorySize();
+
+	_surfaceTrueColor.free();
+
+	delete[] _transparencyMap;
+	_transparencyMap = 0;
+}
+
+void Sprite::linkLazy() const {
+	_lazyPrev = _lazyLast;
+	_lazyNext = 0;
+
+	if (_lazyLast)
+		_lazyLast->_lazyNext = this;
+	else
+		_lazyFirst = this;
+
+	_lazyLast = this;
+}
+
+void Sprite::unlinkLazy() const {
+	if (_lazyPrev)
+		_lazyPrev->_lazyNext = _lazyNext;
+	else if (_lazyFirst == this)
+		_lazyFirst = _lazyNext;
+
+	if (_lazyNext)
+		_lazyNext->_lazyPrev = _lazyPrev;
+	else if (_lazyLast == this)
+		_lazyLast = _lazyPrev;
+
+	_lazyPrev = 0;
+	_lazyNext = 0;
+}
+
+void Sprite::prepareChange() {
+	unshare();
+
+	_spansValid = false;
+
+	if (!_lazyCached)
+		return;
+
+	convertLazy();
+
+	unlinkLazy();
+	_lazyMemorySize -= getTrueColorMemorySize();
+
+	_lazyCached = false;
+
+	// Changing the sprite needs the whole transparency map again
+	_transparencyMap = new uint8[_surfacePaletted.w * _surfacePaletted.h];
+	createTransparencyMap();
+}
+
+void Sprite::createTransparencyMap() const {
 	if (!exists())
 		return;
 
+	_spansValid = false;
+
 	const byte *img = (const byte *) _surfacePaletted.pixels;
 	uint8 *map = _transparencyMap;
 
@@ -254,6 +545,30 @@ void Sprite::updateTransparencyMap() {
 	}
 }
 
+bool Sprite::loadShared(Resources &resources, const Common::String &image) {
+	SpritePtr sprite = SprCache.get(resources, image);
+	if (!sprite) {
+		discard();
+		return false;
+	}
+
+	share(sprite);
+
+	return true;
+}
+
+const Common::String &Sprite::getFileName() const {
+	return _fileName;
+}
+
+bool Sprite::isFlippedHorizontally() const {
+	return _flippedHorizontally;
+}
+
+bool Sprite::isFlippedVertically() const {
+	return _flippedVertically;
+}
+
 bool Sprite::loadFromImage(Resources &resources, const Common::String &image) {
 	return loadFromImage(resources, image, resources.getVersionFormats().getImageType());
 }
@@ -385,8 +700,7 @@ bool Sprite::loadFromBMP(Common::SeekableReadStream &bmp) {
 			return false;
 	}
 
-	createTransparencyMap();
-	convertToTrueColor();
+	createTrueColor();
 
 	return true;
 }
@@ -419,18 +733,24 @@ bool Sprite::loadFromRGB(Common::SeekableReadStream &rgb) {
 	_defaultX = (int32) rgb.readUint16BE();
 	_defaultY = (int32) rgb.readUint16BE();
 
+	const uint32 rowSize = width * 2 + linePad;
+	byte *row = new byte[rowSize];
+
 	byte *img = (byte *) _surfaceTrueColor.pixels;
 	uint8 *transp = _transparencyMap;
 	for (int32 y = 0; y < height; y++) {
-		for (int32 x = 0; x < width; x++) {
-			ImgConv.writeColor(img, readColor555(rgb, transp));
-
-			img += _surfaceTrueColor.bytesPerPixel;
-			transp++;
+		if (rgb.read(row, rowSize) != rowSize) {
+			delete[] row;
+			return false;
 		}
-		rgb.skip(linePad);
+
+		ImgConv.convert555(img, row, width, transp);
+
+		img    += _surfaceTrueColor.pitch;
+		transp += width;
 	}
 
+	delete[] row;
 	return true;
 }
 
@@ -442,15 +762,23 @@ bool Sprite::loadFromBDP(Common::SeekableReadStream &bdp) {
 
 	create(320, 240);
 
-	byte *img = (byte *) _surfaceTrueColor.pixels;
-	for (int32 y = 0; y < 320; y++) {
-		for (int32 x = 0; x < 240; x++) {
-			ImgConv.writeColor(img, readColor555(bdp));
+	const uint32 rowSize = 320 * 2;
+	byte *row = new byte[rowSize];
 
-			img += _surfaceTrueColor.bytesPerPixel;
+	byte *img = (byte *) _surfaceTrueColor.pixels;
+	for (int32 y = 0; y < 240; y++) {
+		if (bdp.read(row, rowSize) != rowSize) {
+			delete[] row;
+			return false;
 		}
+
+		ImgConv.convert555(img, row, 320);
+
+		img += _surfaceTrueColor.pitch;
 	}
 
+	delete[] row;
+
 	// Completely non-transparent
 	memset(_transparencyMap, 0, _surfacePaletted.w * _surfacePaletted.h);
 
@@ -463,15 +791,10 @@ bool Sprite::loadFrom256(Common::SeekableReadStream &f256, int32 width, int32 he
 
 	create(width, height);
 
-	byte *img = (byte *) _surfacePaletted.pixels;
-	for (int32 y = 0; y < width; y++) {
-		for (int32 x = 0; x < height; x++) {
-			*img++ = f256.readByte();
-		}
-	}
+	if (f256.read(_surfacePaletted.pixels, width * height) != ((uint32) (width * height)))
+		return false;
 
-	createTransparencyMap();
-	convertToTrueColor();
+	createTrueColor();
 
 	return true;
 }
@@ -504,18 +827,6 @@ bool Sprite::loadFromSaturnCursor(Common::SeekableReadStream &cursor) {
 	return true;
 }
 
-uint32 Sprite::readColor555(Common::SeekableReadStream &stream, uint8 *transp) const {
-	const uint16 p = stream.readUint16BE();
-	const uint8  r = ((p & 0x001F)      ) << 3;
-	const uint8  g = ((p & 0x03E0) >>  5) << 3;
-	const uint8  b = ((p & 0x7C00) >> 10) << 3;
-
-	if (transp)
-		*transp = (p == 0) ? 1 : 0;
-
-	return ImgConv.getColor(r, g, b);
-}
-
 bool Sprite::loadFromBMP(Resources &resources, const Common::String &bmp) {
 	Common::String bmpFile = Resources::addExtension(bmp,
 			resources.getVersionFormats().getImageExtension(kImageTypeBMP));
@@ -617,45 +928,89 @@ void Sprite::loadPalette(Common::SeekableReadStream &stream, uint32 count) {
 	delete[] palette;
 }
 
+/** Mirror a row of pixels. */
+static void flipRow(byte *row, int32 width, uint8 bpp) {
+	if (bpp == 1) {
+		byte *start = row;
+		byte *end   = row + width - 1;
+
+		while (start < end)
+			SWAP(*start++, *end--);
+
+		return;
+	}
+
+	if (bpp == 2) {
+		uint16 *start = (uint16 *) row;
+		uint16 *end   = start + width - 1;
+
+		while (start < end)
+			SWAP(*start++, *end--);
+
+		return;
+	}
+
+	byte *start = row;
+	byte *end   = row + (width - 1) * bpp;
+
+	while (start < end) {
+		for (uint8 i = 0; i < bpp; i++)
+			SWAP(start[i], end[i]);
+
+		start += bpp;
+		end   -= bpp;
+	}
+}
+
+/** Swap the rows of an image. */
+static void flipRows(byte *data, int32 height, uint32 pitch) {
+	byte *start = data;
+	byte *end   = data + (height - 1) * pitch;
+
+	// Swap through a small buffer on the stack, in pieces if a row doesn't fit
+	byte buffer[512];
+
+	while (start < end) {
+		for (uint32 offset = 0; offset < pitch; offset += sizeof(buffer)) {
+			uint32 size = MIN<uint32>(sizeof(buffer), pitch - offset);
+
+			memcpy(buffer        , start + offset, size);
+			memcpy(start + offset, end   + offset, size);
+			memcpy(end   + offset, buffer        , size);
+		}
+
+		start += pitch;
+		end   -= pitch;
+	}
+}
+
 void Sprite::flipHorizontally() {
 	if (!exists())
 		return;
 
-	int32 width     = _surfacePaletted.w;
-	int32 height    = _surfacePaletted.h;
-	int32 halfWidth = width / 2;
+	if (_shared) {
+		// Show the flipped image instead
+		share(SprCache.getFlipped(_shared, !_flippedHorizontally, _flippedVertically));
+		return;
+	}
+
+	// A lazy sprite's true color data will be recreated out of the flipped paletted data
+	dropLazy();
 
-	byte  *dataPal    = (byte *) _surfacePaletted.pixels;
-	byte  *dataTrue   = (byte *) _surfaceTrueColor.pixels;
-	uint8 *dataTransp =          _transparencyMap;
+	int32 width  = _surfacePaletted.w;
+	int32 height = _surfacePaletted.h;
 
 	for (int32 i = 0; i < height; i++) {
-		byte  *dataPalStart    = dataPal;
-		byte  *dataPalEnd      = dataPal    + width - 1;
-		byte  *dataTrueStart   = dataTrue;
-		byte  *dataTrueEnd     = dataTrue   + _surfaceTrueColor.pitch - _surfaceTrueColor.bytesPerPixel;
-		uint8 *dataTranspStart = dataTransp;
-		uint8 *dataTranspEnd   = dataTransp + width - 1;
-
-		for (int32 j = 0; j < halfWidth; j++) {
-			SWAP(*dataPalStart, *dataPalEnd);
-			dataPalStart++;
-			dataPalEnd--;
-
-			ImgConv.swapColor(dataTrueStart, dataTrueEnd);
-			dataTrueStart += _surfaceTrueColor.bytesPerPixel;
-			dataTrueEnd   -= _surfaceTrueColor.bytesPerPixel;
-
-			SWAP(*dataTranspStart, *dataTranspEnd);
-			dataTranspStart++;
-			dataTranspEnd--;
-		}
+		flipRow((byte *) _surfacePaletted.getBasePtr(0, i), width, 1);
 
-		dataPal    += width;
-		dataTrue   += _surfaceTrueColor.pitch;
-		dataTransp += width;
+		if (_surfaceTrueColor.pixels)
+			flipRow((byte *) _surfaceTrueColor.getBasePtr(0, i), width, _surfaceTrueColor.bytesPerPixel);
+		if (_transparencyMap)
+			flipRow(_transparencyMap + i * width, width, 1);
 	}
 
+	_spansValid = false;
+
 	_feetX = width - _feetX;
 	_flippedHorizontally = !_flippedHorizontally;
 }
@@ -664,53 +1019,87 @@ void Sprite::flipVertically() {
 	if (!exists())
 		return;
 
-	int32 width      = _surfacePaletted.w;
-	int32 height     = _surfacePaletted.h;
-	int32 halfHeight = height / 2;
-
-	byte  *dataPal    = (byte *) _surfacePaletted.pixels;
-	byte  *dataTrue   = (byte *) _surfaceTrueColor.pixels;
-	uint8 *dataTransp =          _transparencyMap;
-
-	byte  *dataPalStart    = dataPal;
-	byte  *dataPalEnd      = dataPal    + (width * height) - width;
-	byte  *dataTrueStart   = dataTrue;
-	byte  *dataTrueEnd     = dataTrue   + (_surfaceTrueColor.pitch * height) - _surfaceTrueColor.pitch;
-	uint8 *dataTranspStart = dataTransp;
-	uint8 *dataTranspEnd   = dataTransp + (width * height) - width;
-
-	byte   *bufferPal    = new byte  [width];
-	byte   *bufferTrue   = new byte  [_surfaceTrueColor.pitch];
-	uint8  *bufferTransp = new uint8 [width];
-
-	for (int32 i = 0; i < halfHeight; i++) {
-		memcpy(bufferPal   , dataPalStart, width);
-		memcpy(dataPalStart, dataPalEnd  , width);
-		memcpy(dataPalEnd  , bufferPal   , width);
-		dataPalStart += width;
-		dataPalEnd   -= width;
-
-		memcpy(bufferTrue   , dataTrueStart, _surfaceTrueColor.pitch);
-		memcpy(dataTrueStart, dataTrueEnd  , _surfaceTrueColor.pitch);
-		memcpy(dataTrueEnd  , bufferTrue   , _surfaceTrueColor.pitch);
-		dataTrueStart += _surfaceTrueColor.pitch;
-		dataTrueEnd   -= _surfaceTrueColor.pitch;
-
-		memcpy(bufferTransp   , dataTranspStart, width);
-		memcpy(dataTranspStart, dataTranspEnd  , width);
-		memcpy(dataTranspEnd  , bufferTransp   , width);
-		dataTranspStart += width;
-		dataTranspEnd   -= width;
-	}
-
-	delete[] bufferPal;
-	delete[] bufferTrue;
-	delete[] bufferTransp;
+	if (_shared) {
+		// Show the flipped image instead
+		share(SprCache.getFlipped(_shared, _flippedHorizontally, !_flippedVertically));
+		return;
+	}
+
+	// A lazy sprite's true color data will be recreated out of the flipped paletted data
+	dropLazy();
+
+	int32 width  = _surfacePaletted.w;
+	int32 height = _surfacePaletted.h;
+
+	flipRows((byte *) _surfacePaletted.pixels, height, _surfacePaletted.pitch);
+
+	if (_surfaceTrueColor.pixels)
+		flipRows((byte *) _surfaceTrueColor.pixels, height, _surfaceTrueColor.pitch);
+	if (_transparencyMap)
+		flipRows(_transparencyMap, height, width);
+
+	_spansValid = false;
 
 	_feetY = height - _feetY;
 	_flippedVertically = !_flippedVertically;
 }
 
+void Sprite::createSpans() const {
+	if (_spansValid)
+		return;
+
+	assert(_transparencyMap);
+
+	const int32 width  = _surfacePaletted.w;
+	const int32 height = _surfacePaletted.h;
+
+	_spans.clear();
+	_spanRows.resize(height + 1);
+
+	const uint8 *map = _transparencyMap;
+	for (int32 y = 0; y < height; y++, map += width) {
+		_spanRows[y] = _spans.size();
+
+		int32 x = 0;
+		while (x < width) {
+			// Find the end of this run of equally transparent pixels
+			int32 n = x + 1;
+			while ((n < width) && (map[n] == map[x]))
+				n++;
+
+			// Fully transparent runs are just left out
+			if (map[x] != 1) {
+				Span span;
+
+				span.x      = x;
+				span.length = n - x;
+				span.transp = map[x];
+
+				_spans.push_back(span);
+			}
+
+			x = n;
+		}
+	}
+
+	_spanRows[height] = _spans.size();
+
+	_spansValid = true;
+}
+
+void Sprite::expandSpans(uint8 *transp, int32 y, int32 x, int32 w) const {
+	memset(transp, 1, w);
+
+	for (uint32 i = _spanRows[y]; i < _spanRows[y + 1]; i++) {
+		const Span &span = _spans[i];
+
+		const int32 left  = MAX<int32>(span.x, x);
+		const int32 right = MIN<int32>(span.x + span.length, x + w);
+		if (left < right)
+			memset(transp + left - x, span.transp, right - left);
+	}
+}
+
 void Sprite::blit(const Sprite &from, const Common::Rect &area, int32 x, int32 y, bool transp) {
 	// Sanity checks
 	assert((x >= 0) && (y >= 0) && (x <= 0x7FFF) && (y <= 0x7FFF));
@@ -718,6 +1107,13 @@ void Sprite::blit(const Sprite &from, const Common::Rect &area, int32 x, int32 y
 	if (!exists() || !from.exists())
 		return;
 
+	prepareChange();
+
+	const Sprite &fromImage = from.getImage();
+
+	fromImage.convertLazy();
+	fromImage.createSpans();
+
 	Common::Rect toArea = getArea(true);
 
 	toArea.left = x;
@@ -739,16 +1135,257 @@ void Sprite::blit(const Sprite &from, const Common::Rect &area, int32 x, int32 y
 	const int32 fromTop   = fracToInt(fromArea.top  * from._scaleInverse);
 	const int32 fromLeft  = fracToInt(fromArea.left * from._scaleInverse);
 
+	const byte *src = (const byte *) fromImage._surfaceTrueColor.getBasePtr(fromLeft, fromTop);
+	      byte *dst = (      byte *)           _surfaceTrueColor.getBasePtr(x, y);
+
+	uint8 *dstT = _transparencyMap + y * _surfaceTrueColor.w + x;
+
+	if (DebugMan.isDebugChannelEnabled(kDebugRefBlit))
+		// Check the fast paths against the original pixel by pixel code
+		blitChecked(fromImage, from._scaleInverse, src, fromLeft, fromTop, x, y, w, h, transp);
+	else
+		blitFast(fromImage, from._scaleInverse, src, fromLeft, fromTop, dst, dstT, w, h, transp);
+}
+
+const char *Sprite::blitFast(const Sprite &from, frac_t scaleInverse, const byte *src,
+		int32 fromLeft, int32 fromTop, byte *dst, uint8 *dstT, int32 w, int32 h, bool transp) {
+
+	if ((scaleInverse == (FRAC_ONE / 2)) && !transp) {
+		blitDoubled(from, src, fromLeft, fromTop, dst, dstT, w, h);
+		return "doubled";
+	}
+
+	if (scaleInverse != FRAC_ONE) {
+		blitScaled(from, scaleInverse, src, fromLeft, fromTop, dst, dstT, w, h, transp);
+		return "scaled";
+	}
+
+	if (!transp) {
+		blitOpaque(from, src, fromLeft, fromTop, dst, dstT, w, h);
+		return "opaque";
+	}
+
+	blitTransparent(from, src, fromLeft, fromTop, dst, dstT, w, h);
+	return "transparent";
+}
+
+void Sprite::blitChecked(const Sprite &from, frac_t scaleInverse, const byte *src,
+		int32 fromLeft, int32 fromTop, int32 x, int32 y, int32 w, int32 h, bool transp) {
+
+	const uint8  bpp     = _surfaceTrueColor.bytesPerPixel;
+	const uint32 rowSize = w * bpp;
+
+	byte  *dst  = (byte *) _surfaceTrueColor.getBasePtr(x, y);
+	uint8 *dstT = _transparencyMap + y * _surfaceTrueColor.w + x;
+
+	// Both blitters have to start out with the same destination
+	byte  *original  = new byte [rowSize * h];
+	uint8 *originalT = new uint8[w * h];
+	byte  *fast      = new byte [rowSize * h];
+	uint8 *fastT     = new uint8[w * h];
+
+	for (int32 i = 0; i < h; i++) {
+		memcpy(original  + i * rowSize, dst  + i * _surfaceTrueColor.pitch, rowSize);
+		memcpy(originalT + i * w      , dstT + i * _surfaceTrueColor.w    , w);
+	}
+
+	const char *path = blitFast(from, scaleInverse, src, fromLeft, fromTop, dst, dstT, w, h, transp);
+
+	// Set the fast path's result aside and restore the destination
+	for (int32 i = 0; i < h; i++) {
+		memcpy(fast  + i * rowSize, dst  + i * _surfaceTrueColor.pitch, rowSize);
+		memcpy(fastT + i * w      , dstT + i * _surfaceTrueColor.w    , w);
+
+		memcpy(dst  + i * _surfaceTrueColor.pitch, original  + i * rowSize, rowSize);
+		memcpy(dstT + i * _surfaceTrueColor.w    , originalT + i * w      , w);
+	}
+
+	blitReference(from, scaleInverse, fromLeft, fromTop, dst, dstT, w, h, transp);
+
+	for (int32 i = 0; i < h; i++) {
+		if (memcmp(fast  + i * rowSize, dst  + i * _surfaceTrueColor.pitch, rowSize) ||
+		    memcmp(fastT + i * w      , dstT + i * _surfaceTrueColor.w    , w)) {
+
+			warning("Sprite::blit(): The %s blit of (%d+%d, %d+%d) differs from the reference in row %d",
+					path, x, w, y, h, i);
+			break;
+		}
+	}
+
+	delete[] original;
+	delete[] originalT;
+	delete[] fast;
+	delete[] fastT;
+}
+
+void Sprite::blitOpaque(const Sprite &from, const byte *src, int32 fromLeft, int32 fromTop,
+		byte *dst, uint8 *dstT, int32 w, int32 h) {
+
+	const uint8 bpp = _surfaceTrueColor.bytesPerPixel;
+
+	for (int32 i = 0; i < h; i++) {
+		// Ignoring transparency => copy whole rows
+		memcpy(dst, src, w * bpp);
+		from.expandSpans(dstT, fromTop + i, fromLeft, w);
+
+		src  += from._surfaceTrueColor.pitch;
+		dst  +=      _surfaceTrueColor.pitch;
+		dstT +=      _surfaceTrueColor.w;
+	}
+}
+
+void Sprite::blitTransparent(const Sprite &from, const byte *src, int32 fromLeft, int32 fromTop,
+		byte *dst, uint8 *dstT, int32 w, int32 h) {
+
+	const uint8 bpp = _surfaceTrueColor.bytesPerPixel;
+
+	for (int32 i = 0; i < h; i++) {
+		const uint32 rowEnd = from._spanRows[fromTop + i + 1];
+
+		// Fully transparent runs aren't in the span list, so they leave the destination alone
+		for (uint32 s = from._spanRows[fromTop + i]; s < rowEnd; s++) {
+			const Span &span = from._spans[s];
+
+			if (span.x >= (fromLeft + w))
+				break;
+
+			// Clip the span to the blitted area
+			const int32 left  = MAX<int32>(span.x, fromLeft) - fromLeft;
+			const int32 right = MIN<int32>(span.x + span.length, fromLeft + w) - fromLeft;
+			if (left >= right)
+				continue;
+
+			if (span.transp == 0) {
+				// Source is solid => copy the whole span
+				memcpy(dst  + left * bpp, src + left * bpp, (right - left) * bpp);
+				memset(dstT + left      , 0               ,  right - left);
+				continue;
+			}
+
+			// Half-transparent
+			for (int32 k = left; k < right; k++) {
+				if (dstT[k] == 1)
+					// But destination is transparent => propagate
+					memcpy(dst + k * bpp, src + k * bpp, bpp);
+				else
+					// Destination is solid => mix
+					ImgConv.mixTrueColor(dst + k * bpp, src + k * bpp);
+
+				dstT[k] = 2;
+			}
+		}
+
+		src  += from._surfaceTrueColor.pitch;
+		dst  +=      _surfaceTrueColor.pitch;
+		dstT +=      _surfaceTrueColor.w;
+	}
+}
+
+void Sprite::blitScaled(const Sprite &from, frac_t scaleInverse, const byte *src,
+		int32 fromLeft, int32 fromTop, byte *dst, uint8 *dstT, int32 w, int32 h, bool transp) {
+
+	const uint8 bpp = _surfaceTrueColor.bytesPerPixel;
+
+	// Which source column and row ends up in which destination column and row
+	const int32 *indices = getScaleTable(scaleInverse, MAX(w, h));
+
+	// The transparency of the current source row
+	uint8 *srcT = getRowTransparency(from._surfacePaletted.w);
+
+	int32 srcTY = -1;
+	for (int32 i = 0; i < h; i++) {
+		const int32 srcY = fromTop + indices[i];
+
+		if (srcY != srcTY) {
+			from.expandSpans(srcT, srcY, 0, from._surfacePaletted.w);
+			srcTY = srcY;
+		}
+
+		const byte *srcLine = src + indices[i] * from._surfaceTrueColor.pitch;
+
+		byte  *dstRow  = dst;
+		uint8 *dstRowT = dstT;
+
+		for (int32 j = 0; j < w; j++, dstRow += bpp, dstRowT++) {
+			const byte  *srcRow  = srcLine + indices[j] * bpp;
+			const uint8 *srcRowT = srcT    + indices[j] + fromLeft;
+
+			if (!transp || (*srcRowT == 0)) {
+				// Ignore transparency or source is solid => copy
+				memcpy(dstRow, srcRow, bpp);
+				*dstRowT = *srcRowT;
+			} else if (*srcRowT == 2) {
+				// Half-transparent
+				if (*dstRowT == 1)
+					// But destination is transparent => propagate
+					memcpy(dstRow, srcRow, bpp);
+				else
+					// Destination is solid => mix
+					ImgConv.mixTrueColor(dstRow, srcRow);
+
+				*dstRowT = *srcRowT;
+			}
+		}
+
+		dst  += _surfaceTrueColor.pitch;
+		dstT += _surfaceTrueColor.w;
+	}
+}
+
+void Sprite::blitDoubled(const Sprite &from, const byte *src, int32 fromLeft, int32 fromTop,
+		byte *dst, uint8 *dstT, int32 w, int32 h) {
+
+	const uint8 bpp = _surfaceTrueColor.bytesPerPixel;
+
+	// The transparency of the current source row
+	uint8 *srcT = getRowTransparency((w + 1) / 2);
+
+	for (int32 i = 0; i < h; i += 2) {
+		from.expandSpans(srcT, fromTop + i / 2, fromLeft, (w + 1) / 2);
+
+		// Double every pixel of the source row
+		if (bpp == 2) {
+			const uint16 *srcRow = (const uint16 *) src;
+			      uint16 *dstRow = (      uint16 *) dst;
+
+			for (int32 j = 0; j < w; j++)
+				dstRow[j] = srcRow[j >> 1];
+		} else
+			for (int32 j = 0; j < w; j++)
+				memcpy(dst + j * bpp, src + (j >> 1) * bpp, bpp);
+
+		for (int32 j = 0; j < w; j++)
+			dstT[j] = srcT[j >> 1];
+
+		// And then the whole row
+		if ((i + 1) < h) {
+			memcpy(dst  + _surfaceTrueColor.pitch, dst , w * bpp);
+			memcpy(dstT + _surfaceTrueColor.w    , dstT, w);
+		}
+
+		src  += from._surfaceTrueColor.pitch;
+		dst  += 2 * _surfaceTrueColor.pitch;
+		dstT += 2 * _surfaceTrueColor.w;
+	}
+}
+
+void Sprite::blitReference(const Sprite &from, frac_t scaleInverse, int32 fromLeft, int32 fromTop,
+		byte *dst, uint8 *dstT, int32 w, int32 h, bool transp) {
+
 	const byte *src = (const byte *) from._surfaceTrueColor.getBasePtr(fromLeft, fromTop);
-	      byte *dst = (      byte *)      _surfaceTrueColor.getBasePtr(x, y);
 
-	const uint8 *srcT = from._transparencyMap + fromTop * from._surfaceTrueColor.w + fromLeft;
-	      uint8 *dstT =      _transparencyMap +       y *      _surfaceTrueColor.w + x;
+	// Lazy sprites don't keep their transparency map, so go through the spans instead
+	const int32 srcTWidth = from._surfacePaletted.w - fromLeft;
+	uint8 *srcT = getRowTransparency(srcTWidth);
+
+	int32 srcY = fromTop;
 
 	frac_t posW = 0, posH = 0;
 	while (h-- > 0) {
 		posW = 0;
 
+		from.expandSpans(srcT, srcY, fromLeft, srcTWidth);
+
 		const byte *srcRow = src;
 		      byte *dstRow = dst;
 
@@ -773,7 +1410,7 @@ void Sprite::blit(const Sprite &from, const Common::Rect &area, int32 x, int32 y
 			}
 
 			// Advance source data
-			posW += from._scaleInverse;
+			posW += scaleInverse;
 			while (posW >= ((frac_t) FRAC_ONE)) {
 				srcRow += from._surfaceTrueColor.bytesPerPixel;
 				srcRowT++;
@@ -786,10 +1423,10 @@ void Sprite::blit(const Sprite &from, const Common::Rect &area, int32 x, int32 y
 		dstT += _surfaceTrueColor.w;
 
 		// Advance source data
-		posH += from._scaleInverse;
+		posH += scaleInverse;
 		while (posH >= ((frac_t) FRAC_ONE)) {
-			src  += from._surfaceTrueColor.pitch;
-			srcT += from._surfaceTrueColor.w;
+			src += from._surfaceTrueColor.pitch;
+			srcY++;
 			posH -= FRAC_ONE;
 		}
 
@@ -819,6 +1456,8 @@ void Sprite::fill(byte c) {
 	if (!exists())
 		return;
 
+	prepareChange();
+
 	fillImage(c, ImgConv.convertColor(c, _palette));
 
 	memset(_transparencyMap, 0, _surfacePaletted.w * _surfacePaletted.h);
@@ -828,6 +1467,8 @@ void Sprite::fill(uint32 c) {
 	if (!exists())
 		return;
 
+	prepareChange();
+
 	fillImage(0, c);
 
 	memset(_transparencyMap, 0, _surfacePaletted.w * _surfacePaletted.h);
@@ -837,6 +1478,8 @@ void Sprite::clear() {
 	if (!exists())
 		return;
 
+	prepareChange();
+
 	fillImage(0, ImgConv.convertColor(0, _palette));
 
 	memset(_transparencyMap, 1, _surfacePaletted.w * _surfacePaletted.h);
@@ -846,6 +1489,8 @@ void Sprite::darken() {
 	if (!exists())
 		return;
 
+	prepareChange();
+
 	fillImage(0, ImgConv.getColor(0, 0, 0));
 
 	memset(_transparencyMap, 0, _surfacePaletted.w * _surfacePaletted.h);
@@ -855,6 +1500,8 @@ void Sprite::shade(uint32 c) {
 	if (!exists())
 		return;
 
+	prepareChange();
+
 	fillImage(0, c);
 
 	memset(_transparencyMap, 2, _surfacePaletted.w * _surfacePaletted.h);
@@ -863,6 +1510,8 @@ void Sprite::shade(uint32 c) {
 void Sprite::drawStrings(const FontManager::TextList &strings, const FontManager &fontManager,
 		int x, int y, uint32 color) {
 
+	prepareChange();
+
 	for (FontManager::TextList::const_iterator it = strings.begin(); it != strings.end(); ++it) {
 		fontManager.drawText(_surfaceTrueColor, *it, x, y, color);
 
@@ -880,10 +1529,8 @@ bool Sprite::readBMPDataComp0(Common::SeekableReadStream &bmp, uint32 dataSize)
 
 	int extraDataLength = (width % 4) ? 4 - (width % 4) : 0;
 	for (int32 i = 0; i < height; i++) {
-		byte *rowData = data;
-
-		for (int32 j = 0; j < width; j++)
-			*rowData++ = bmp.readByte();
+		if (bmp.read(data, width) != ((uint32) width))
+			return false;
 
 		bmp.skip(extraDataLength);
 		data -= width;
@@ -957,7 +1604,10 @@ bool Sprite::loading(Resources &resources) {
 	byte   flippedVertically   = _flippedVertically;
 	uint32 scale               = _scale;
 
-	loadFromImage(resources, _fileName);
+	if (_shared)
+		loadShared(resources, _fileName);
+	else
+		loadFromImage(resources, _fileName);
 
 	if (flippedHorizontally)
 		flipHorizontally();
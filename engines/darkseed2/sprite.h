@@ -30,6 +30,7 @@
 #include "common/str.h"
 #include "common/array.h"
 #include "common/frac.h"
+#include "common/ptr.h"
 
 #include "graphics/font.h"
 #include "graphics/surface.h"
@@ -112,11 +113,22 @@ public:
 	/** Load from a cursor found in the Sega Saturn version. */
 	bool loadFromSaturnCursor(Resources &resources, const Common::String &cursor);
 
+	/** Load a sprite from an image file, sharing the image data with all other sprites showing it. */
+	bool loadShared(Resources &resources, const Common::String &image);
+
+	/** Return the file the sprite was loaded from. */
+	const Common::String &getFileName() const;
+
 	/** Flip the sprite horizontally. */
 	void flipHorizontally();
 	/** Flip the sprite vertically. */
 	void flipVertically();
 
+	/** Was the sprite flipped horizontally? */
+	bool isFlippedHorizontally() const;
+	/** Was the sprite flipped vertically? */
+	bool isFlippedVertically() const;
+
 	/** Blit that sprite onto this sprite. */
 	void blit(const Sprite &from, const Common::Rect &area,
 			int32 x, int32 y, bool transp = false);
@@ -144,6 +156,15 @@ public:
 	/** Set the scaling value. */
 	void setScale(frac_t scale);
 
+	/** Only convert paletted images to true color when they're drawn, and drop that again when memory is low. */
+	void setLazy(bool lazy);
+
+	/** Return the amount of memory currently held by the sprite's data. */
+	uint32 getMemorySize() const;
+
+	/** Return the amount of memory held by the true color data of all lazy sprites. */
+	static uint32 getLazyMemorySize();
+
 protected:
 	bool saveLoad(Common::Serializer &serializer, Resources &resources);
 	bool loading(Resources &resources);
@@ -152,10 +173,37 @@ private:
 	Common::String _fileName; ///< The file from which the sprite was loaded.
 	bool _fromCursor; ///< Was the sprite loaded from a cursor resource?
 
-	::Graphics::Surface _surfacePaletted;  ///< The sprite's (original) paletted data.
-	::Graphics::Surface _surfaceTrueColor; ///< The sprite's true color data.
+	/** Memory the true color data of lazy sprites may use up. */
+	static const uint32 kLazyBudget = 4 * 1024 * 1024;
+
+	static const Sprite *_lazyFirst;      ///< The least recently drawn converted lazy sprite.
+	static const Sprite *_lazyLast;       ///< The most recently drawn converted lazy sprite.
+	static uint32        _lazyMemorySize; ///< Memory used by the true color data of lazy sprites.
+
+	::Graphics::Surface _surfacePaletted;          ///< The sprite's (original) paletted data.
+	mutable ::Graphics::Surface _surfaceTrueColor; ///< The sprite's true color data.
+
+	mutable uint8 *_transparencyMap; ///< The sprite's transparency map.
+
+	/** The sprite whose image data this sprite shows, until it's changed. */
+	Common::SharedPtr<Sprite> _shared;
+
+	bool _lazy;       ///< Convert to true color only when needed?
+	bool _lazyCached; ///< Is the true color data only a cache of the paletted data?
 
-	uint8 *_transparencyMap; ///< The sprite's transparency map.
+	mutable const Sprite *_lazyPrev; ///< The previous sprite in the list of converted lazy sprites.
+	mutable const Sprite *_lazyNext; ///< The next sprite in the list of converted lazy sprites.
+
+	/** A horizontal run of equally transparent, visible pixels. */
+	struct Span {
+		uint16 x;      ///< The first pixel of the run.
+		uint16 length; ///< The number of pixels in the run.
+		uint8  transp; ///< The pixels' transparency map value.
+	};
+
+	mutable Common::Array<Span>   _spans;      ///< All visible runs, row by row.
+	mutable Common::Array<uint32> _spanRows;   ///< Index of each row's first span, plus the end.
+	mutable bool                  _spansValid; ///< Do the spans match the transparency map?
 
 	int32 _defaultX; ///< The sprite's default X coordinate.
 	int32 _defaultY; ///< The sprite's default Y coordinate.
@@ -174,16 +222,71 @@ private:
 	/** Clear/Initialize. */
 	void clearData();
 
+	/** Return the sprite holding the image data. */
+	const Sprite &getImage() const;
+
+	/** Copy everything but the image data and scaling from another sprite. */
+	void copyProperties(const Sprite &sprite);
+
+	/** Show the image data of that sprite. */
+	void share(const Common::SharedPtr<Sprite> &sprite);
+	/** Make a copy of the shared image data, so that it can be changed. */
+	void unshare();
+
+	/** Return the amount of memory held by the true color data and transparency map. */
+	uint32 getTrueColorMemorySize() const;
+
 	/** Convert the paletted 8bit data to true color data. */
-	void convertToTrueColor(bool system = false);
+	void convertToTrueColor(bool system = false) const;
 
 	/** Create the transparency map. */
-	void createTransparencyMap();
+	void createTransparencyMap() const;
 	/** Update the transparency map after drawing to the true color surface. */
 	void updateTransparencyMap();
 
+	/** Create the transparency map and true color data after loading paletted data. */
+	void createTrueColor();
+
+	/** Make sure the true color data of a lazy sprite exists. */
+	void convertLazy() const;
+	/** Drop the true color data of a lazy sprite. */
+	void dropLazy() const;
+	/** Add the sprite to the end of the list of converted lazy sprites. */
+	void linkLazy() const;
+	/** Remove the sprite from the list of converted lazy sprites. */
+	void unlinkLazy() const;
+	/** The sprite is about to be changed, so it can't be lazy anymore and its spans are outdated. */
+	void prepareChange();
+
 	void fillImage(byte cP, uint32 cT);
 
+	/** Create the spans out of the transparency map, if necessary. */
+	void createSpans() const;
+	/** Write the transparency map values of part of a row, as recorded in the spans. */
+	void expandSpans(uint8 *transp, int32 y, int32 x, int32 w) const;
+
+	/** Blit an unscaled sprite, ignoring transparency. */
+	void blitOpaque(const Sprite &from, const byte *src, int32 fromLeft, int32 fromTop,
+			byte *dst, uint8 *dstT, int32 w, int32 h);
+	/** Blit an unscaled sprite, honoring transparency. */
+	void blitTransparent(const Sprite &from, const byte *src, int32 fromLeft, int32 fromTop,
+			byte *dst, uint8 *dstT, int32 w, int32 h);
+	/** Blit a scaled sprite. */
+	void blitScaled(const Sprite &from, frac_t scaleInverse, const byte *src,
+			int32 fromLeft, int32 fromTop, byte *dst, uint8 *dstT, int32 w, int32 h, bool transp);
+	/** Blit a sprite scaled to double its size, ignoring transparency. */
+	void blitDoubled(const Sprite &from, const byte *src, int32 fromLeft, int32 fromTop,
+			byte *dst, uint8 *dstT, int32 w, int32 h);
+	/** Blit a sprite through the fitting fast path, returns the path's name. */
+	const char *blitFast(const Sprite &from, frac_t scaleInverse, const byte *src,
+			int32 fromLeft, int32 fromTop, byte *dst, uint8 *dstT, int32 w, int32 h, bool transp);
+	/** Blit a sprite through both the fast path and the reference, and warn if they differ. */
+	void blitChecked(const Sprite &from, frac_t scaleInverse, const byte *src,
+			int32 fromLeft, int32 fromTop, int32 x, int32 y, int32 w, int32 h, bool transp);
+	/** Blit a sprite pixel by pixel, the slow way all the other blitters have to match. */
+	void blitReference(const Sprite &from, frac_t scaleInverse, int32 fromLeft, int32 fromTop,
+			byte *dst, uint8 *dstT, int32 w, int32 h, bool transp);
+
 	bool loadFromImage(Resources &resources, const Common::String &image, ImageType imageType);
 
 	/** Load a sprite from a BMP. */
@@ -209,8 +312,6 @@ private:
 	/** Load from a cursor found in the Sega Saturn version. */
 	bool loadFromSaturnCursor(Common::SeekableReadStream &cursor);
 
-	uint32 readColor555(Common::SeekableReadStream &stream, uint8 *transp = 0) const;
-
 	void loadPalette(Common::SeekableReadStream &stream, uint32 count);
 
 	/** Read uncompressed BMP data. */
@@ -219,6 +320,8 @@ private:
 	bool readBMPDataComp2(Common::SeekableReadStream &bmp, uint32 dataSize);
 };
 
+typedef Common::SharedPtr<Sprite> SpritePtr;
+
 } // End of namespace DarkSeed2
 
 #endif // DARKSEED2_SPRITE_H
@@ -0,0 +1,132 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#include "common/array.h"
+
+#include "engines/darkseed2/spritecache.h"
+#include "engines/darkseed2/resources.h"
+
+DECLARE_SINGLETON(DarkSeed2::SpriteCache);
+
+namespace DarkSeed2 {
+
+SpriteCache::SpriteCache() {
+}
+
+SpriteCache::~SpriteCache() {
+	clear();
+}
+
+SpritePtr SpriteCache::get(Resources &resources, const Common::String &image) {
+	Common::String key = makeKey(image, false, false);
+
+	SpriteMap::iterator cached = _sprites.find(key);
+	if (cached != _sprites.end())
+		return cached->_value;
+
+	SpritePtr sprite(new Sprite);
+
+	sprite->setLazy(true);
+	if (!sprite->loadFromImage(resources, image))
+		return SpritePtr();
+
+	add(key, sprite);
+
+	return sprite;
+}
+
+SpritePtr SpriteCache::getFlipped(const SpritePtr &sprite,
+		bool flippedHorizontally, bool flippedVertically) {
+
+	if ((sprite->isFlippedHorizontally() == flippedHorizontally) &&
+	    (sprite->isFlippedVertically()   == flippedVertically))
+		return sprite;
+
+	Common::String key = makeKey(sprite->getFileName(), flippedHorizontally, flippedVertically);
+
+	SpriteMap::iterator cached = _sprites.find(key);
+	if (cached != _sprites.end())
+		return cached->_value;
+
+	SpritePtr flipped(new Sprite(*sprite));
+
+	if (flipped->isFlippedHorizontally() != flippedHorizontally)
+		flipped->flipHorizontally();
+	if (flipped->isFlippedVertically()   != flippedVertically)
+		flipped->flipVertically();
+
+	add(key, flipped);
+
+	return flipped;
+}
+
+void SpriteCache::add(const Common::String &key, const SpritePtr &sprite) {
+	// Sprites without their own palette are converted using the palette
+	// active at load time, so they can't be shared with later users
+	if (sprite->getPalette().empty())
+		return;
+
+	_sprites.setVal(key, sprite);
+}
+
+void SpriteCache::trim() {
+	uint32 count = _sprites.size();
+
+	// Only the cache itself still holds those
+	Common::Array<Common::String> unused;
+	for (SpriteMap::iterator it = _sprites.begin(); it != _sprites.end(); ++it)
+		if (it->_value.unique())
+			unused.push_back(it->_key);
+
+	for (Common::Array<Common::String>::const_iterator it = unused.begin(); it != unused.end(); ++it)
+		_sprites.erase(*it);
+
+	debugC(2, kDebugGraphics, "Released %d of %d cached sprites", count - _sprites.size(), count);
+}
+
+void SpriteCache::clear() {
+	_sprites.clear();
+}
+
+uint32 SpriteCache::getCount() const {
+	return _sprites.size();
+}
+
+uint32 SpriteCache::getMemorySize() const {
+	uint32 size = 0;
+
+	for (SpriteMap::const_iterator it = _sprites.begin(); it != _sprites.end(); ++it)
+		size += it->_value->getMemorySize();
+
+	return size;
+}
+
+Common::String SpriteCache::makeKey(const Common::String &image,
+		bool flippedHorizontally, bool flippedVertically) {
+
+	return Common::String::format("%s:%d%d", image.c_str(), flippedHorizontally, flippedVertically);
+}
+
+} // End of namespace DarkSeed2
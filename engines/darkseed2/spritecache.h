@@ -0,0 +1,80 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+
+#ifndef DARKSEED2_SPRITECACHE_H
+#define DARKSEED2_SPRITECACHE_H
+
+#include "common/singleton.h"
+#include "common/str.h"
+#include "common/hashmap.h"
+#include "common/hash-str.h"
+
+#include "engines/darkseed2/sprite.h"
+
+namespace DarkSeed2 {
+
+class Resources;
+
+/** A cache of sprites loaded from image files, shared by everything showing the same image. */
+class SpriteCache : public Common::Singleton<SpriteCache> {
+public:
+	/** Get the sprite loaded from this image, returns an empty pointer upon failure. */
+	SpritePtr get(Resources &resources, const Common::String &image);
+	/** Get the variant of that cached sprite with these flips applied. */
+	SpritePtr getFlipped(const SpritePtr &sprite, bool flippedHorizontally, bool flippedVertically);
+
+	/** Forget all sprites that aren't in use anymore. */
+	void trim();
+	/** Forget all sprites. */
+	void clear();
+
+	/** Return the number of cached sprites. */
+	uint32 getCount() const;
+	/** Return the amount of memory held by the cached sprites. */
+	uint32 getMemorySize() const;
+
+private:
+	friend class Common::Singleton<SingletonBaseType>;
+
+	typedef Common::HashMap<Common::String, SpritePtr, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> SpriteMap;
+
+	SpriteMap _sprites; ///< All cached sprites, by image name and flips.
+
+	SpriteCache();
+	~SpriteCache();
+
+	/** Put the sprite into the cache, if the image always looks the same. */
+	void add(const Common::String &key, const SpritePtr &sprite);
+
+	static Common::String makeKey(const Common::String &image,
+			bool flippedHorizontally, bool flippedVertically);
+};
+
+} // End of namespace DarkSeed2
+
+#define SprCache (::DarkSeed2::SpriteCache::instance())
+
+#endif // DARKSEED2_SPRITECACHE_H
@@ -33,7 +33,151 @@
 
 namespace DarkSeed2 {
 
+Condition::Condition() {
+}
+
+Condition::Condition(const Variables &variables, const Common::String &condition) {
+	add(variables, condition);
+}
+
+Condition::Condition(const Variables &variables, const Common::List<Common::String> &conditions) {
+	for (Common::List<Common::String>::const_iterator it = conditions.begin(); it != conditions.end(); ++it)
+		add(variables, *it);
+}
+
+void Condition::clear() {
+	_terms.clear();
+	_alternatives.clear();
+	_reads.clear();
+}
+
+bool Condition::empty() const {
+	return _alternatives.empty();
+}
+
+void Condition::add(const Variables &variables, const Common::String &condition) {
+	Common::StringTokenizer tokenizer(condition, " ");
+
+	while (!tokenizer.empty()) {
+		Term term;
+
+		if (!parseTerm(variables, tokenizer.nextToken(), term))
+			continue;
+
+		_terms.push_back(term);
+
+		// Remember which variables the condition depends on
+		bool known = false;
+		for (uint i = 0; i < _reads.size(); i++)
+			if (_reads[i] == term.variable)
+				known = true;
+
+		if (!known)
+			_reads.push_back(term.variable);
+	}
+
+	_alternatives.push_back(_terms.size());
+}
+
+bool Condition::parseTerm(const Variables &variables, const Common::String &conditionPart, Term &term) {
+	if (conditionPart.empty())
+		return false;
+
+	term.equal = true;
+
+	if        (conditionPart[0] == '*') {
+		// Meaning of '*' not yet understood
+		term.variable = variables.intern(conditionPart.c_str() + 1);
+		term.value    = 23;
+	} else if (conditionPart[0] == '+') {
+		// Meaning of '+' not yet understood
+		term.variable = variables.intern(conditionPart.c_str() + 1);
+		term.value    = 24;
+	} else if (conditionPart[0] == '@') {
+		// Meaning of '@' not yet understood
+		term.variable = variables.intern(conditionPart.c_str() + 1);
+		term.value    = 25;
+	} else if (conditionPart[0] == '!') {
+		term.variable = variables.intern(conditionPart.c_str() + 1);
+		term.value    = 0;
+	} else if (conditionPart[0] == '=') {
+		Common::StringTokenizer tokenizerPart(conditionPart.c_str() + 1, ",");
+
+		term.variable = variables.intern(tokenizerPart.nextToken());
+		term.value    = atoi(tokenizerPart.nextToken().c_str());
+	} else {
+		term.variable = variables.intern(conditionPart);
+		term.value    = 0;
+		term.equal    = false;
+	}
+
+	return true;
+}
+
+
+ChangeSet::ChangeSet() {
+}
+
+ChangeSet::ChangeSet(const Variables &variables, const Common::String &change) {
+	add(variables, change);
+}
+
+void ChangeSet::clear() {
+	_assignments.clear();
+}
+
+bool ChangeSet::empty() const {
+	return _assignments.empty();
+}
+
+void ChangeSet::add(const Variables &variables, const Common::String &change) {
+	Common::StringTokenizer tokenizer(change, " ");
+
+	while (!tokenizer.empty()) {
+		Assignment assignment;
+
+		if (parseAssignment(variables, tokenizer.nextToken(), assignment))
+			_assignments.push_back(assignment);
+	}
+}
+
+bool ChangeSet::parseAssignment(const Variables &variables, const Common::String &changePart,
+		Assignment &assignment) {
+
+	if (changePart.empty())
+		return false;
+
+	if        (changePart[0] == '*') {
+		// Meaning of '*' not yet understood
+		assignment.variable = variables.intern(changePart.c_str() + 1);
+		assignment.value    = 23;
+	} else if (changePart[0] == '+') {
+		// Meaning of '+' not yet understood
+		assignment.variable = variables.intern(changePart.c_str() + 1);
+		assignment.value    = 24;
+	} else if (changePart[0] == '@') {
+		// Meaning of '@' not yet understood
+		assignment.variable = variables.intern(changePart.c_str() + 1);
+		assignment.value    = 25;
+	} else if (changePart[0] == '!') {
+		assignment.variable = variables.intern(changePart.c_str() + 1);
+		assignment.value    = 0;
+	} else if (changePart[0] == '=') {
+		Common::StringTokenizer tokenizerPart(changePart.c_str() + 1, ",");
+
+		assignment.variable = variables.intern(tokenizerPart.nextToken());
+		assignment.value    = atoi(tokenizerPart.nextToken().c_str());
+	} else {
+		assignment.variable = variables.intern(changePart);
+		assignment.value    = 1;
+	}
+
+	return true;
+}
+
+
 Variables::Variables(Common::RandomSource &rnd) : _rnd(&rnd) {
+	_changeCount = 1;
 }
 
 Variables::~Variables() {
@@ -42,51 +186,121 @@ Variables::~Variables() {
 }
 
 void Variables::clear() {
-	_variables.clear();
+	changed();
 
-	_lastChanged = g_system->getMillis();
+	for (uint32 i = 0; i < _values.size(); i++) {
+		_values  [i] = 0;
+		_flags   [i] &= ~kSlotGlobal;
+		_versions[i] = _changeCount;
+	}
 }
 
 void Variables::clearLocal() {
-	_localVariables.clear();
+	changed();
+
+	for (Common::Array<uint32>::const_iterator it = _localSlots.begin(); it != _localSlots.end(); ++it) {
+		_flags   [*it] &= ~kSlotLocal;
+		_versions[*it] = _changeCount;
+	}
 
-	_lastChanged = g_system->getMillis();
+	_localSlots.clear();
 }
 
 void Variables::addLocal(const Common::String &var) {
-	_localVariables.setVal(var, 0);
+	uint32 slot = intern(var);
+
+	if (!(_flags[slot] & kSlotLocal)) {
+		_flags[slot] |= kSlotLocal;
+		_localSlots.push_back(slot);
+	}
+
+	_localValues[slot] = 0;
 
-	_lastChanged = g_system->getMillis();
+	changed(slot);
 }
 
-void Variables::set(const Common::String &var, uint8 value) {
-	if (_localVariables.contains(var))
-		_localVariables.setVal(var, value);
-	else
-		_variables.setVal(var, value);
+uint32 Variables::intern(const Common::String &var) const {
+	SlotMap::iterator slot = _slots.find(var);
+	if (slot != _slots.end())
+		return slot->_value;
+
+	uint32 newSlot = _names.size();
+
+	_slots.setVal(var, newSlot);
+	_names.push_back(var);
+	_values.push_back(0);
+	_localValues.push_back(0);
+	_flags.push_back(0);
+	_versions.push_back(_changeCount);
+
+	return newSlot;
+}
+
+const Common::String &Variables::getName(uint32 slot) const {
+	assert(slot < _names.size());
+
+	return _names[slot];
+}
+
+void Variables::set(uint32 slot, uint8 value) {
+	assert(slot < _names.size());
+
+	if (_flags[slot] & kSlotLocal)
+		_localValues[slot] = value;
+	else {
+		_values[slot] = value;
+		_flags [slot] |= kSlotGlobal;
+	}
 
-	_lastChanged = g_system->getMillis();
+	changed(slot);
+}
+
+void Variables::setGlobal(uint32 slot, uint8 value) {
+	_values[slot] = value;
+	_flags [slot] |= kSlotGlobal;
+
+	changed(slot);
+}
+
+uint8 Variables::get(uint32 slot) const {
+	assert(slot < _names.size());
+
+	if (_flags[slot] & kSlotLocal)
+		return _localValues[slot];
+
+	// Never set global values are 0
+	return _values[slot];
+}
+
+void Variables::set(const Common::String &var, uint8 value) {
+	set(intern(var), value);
 }
 
 uint8 Variables::get(const Common::String &var) const {
-	if (_localVariables.contains(var))
-		return _localVariables.getVal(var);
+	return get(intern(var));
+}
 
-	return _variables.getVal(var);
+uint32 Variables::getChangeCount() const {
+	return _changeCount;
 }
 
-uint8 Variables::get(const Common::String &var, uint8 def) const {
-	if (_localVariables.contains(var))
-		return _localVariables.getVal(var);
+uint32 Variables::getVersion(const Condition &condition) const {
+	uint32 version = 0;
 
-	if (_variables.contains(var))
-		return _variables.getVal(var);
+	for (uint i = 0; i < condition._reads.size(); i++)
+		version = MAX(version, _versions[condition._reads[i]]);
 
-	return def;
+	return version;
 }
 
-uint32 Variables::getLastChanged() const {
-	return _lastChanged;
+void Variables::changed() {
+	_changeCount++;
+}
+
+void Variables::changed(uint32 slot) {
+	changed();
+
+	_versions[slot] = _changeCount;
 }
 
 void Variables::reRollRandom() {
@@ -110,11 +324,9 @@ bool Variables::loadFromIDX(Common::SeekableReadStream &idx) {
 		if (value.empty())
 			continue;
 
-		_variables.setVal(varName, (uint8) atoi(value.c_str()));
+		setGlobal(intern(varName), atoi(value.c_str()));
 	}
 
-	_lastChanged = g_system->getMillis();
-
 	return true;
 }
 
@@ -133,66 +345,35 @@ bool Variables::loadFromIDX(Resources &resources, const Common::String &idx) {
 }
 
 bool Variables::evalCondition(const Common::String &condition) const {
-	bool result = true;
-
-	Common::StringTokenizer tokenizer(condition, " ");
-
-	while (!tokenizer.empty()) {
-		Common::String condPart = tokenizer.nextToken();
-
-		result = result && evalConditionPart(condPart);
-	}
-
-	return result;
+	return evalCondition(Condition(*this, condition));
 }
 
 bool Variables::evalCondition(const Common::List<Common::String> &condition) const {
-	for (Common::List<Common::String>::const_iterator it = condition.begin(); it != condition.end(); ++it)
-		if (evalCondition(*it))
-			return true;
-
-	return false;
+	return evalCondition(Condition(*this, condition));
 }
 
-bool Variables::evalConditionPart(const Common::String &conditionPart) const {
-	if (conditionPart[0] == '*')
-/*		warning("Variables::evalConditionPart(): "
-				"Meaning of '*' not yet understood in condition part \"%s\"",
-				conditionPart.c_str());*/
-		return get(conditionPart.c_str() + 1, 0) == 23;
-	else if (conditionPart[0] == '+')
-/*		warning("Variables::evalConditionPart(): "
-				"Meaning of '+' not yet understood in condition part \"%s\"",
-				conditionPart.c_str());*/
-		return get(conditionPart.c_str() + 1, 0) == 24;
-	else if (conditionPart[0] == '@')
-/*		warning("Variables::evalConditionPart(): "
-				"Meaning of '@' not yet understood in condition part \"%s\"",
-				conditionPart.c_str());*/
-		return get(conditionPart.c_str() + 1, 0) == 25;
-	else if (conditionPart[0] == '!')
-		return get(conditionPart.c_str() + 1, 0) == 0;
-	else if (conditionPart[0] == '=') {
-		Common::StringTokenizer tokenizerPart(conditionPart.c_str() + 1, ",");
+bool Variables::evalCondition(const Condition &condition) const {
+	const Condition::Term *term = condition._terms.begin();
 
-		Common::String varName = tokenizerPart.nextToken();
-		Common::String value   = tokenizerPart.nextToken();
+	// Any alternative whose terms are all met will do
+	for (uint i = 0; i < condition._alternatives.size(); i++) {
+		const Condition::Term *end = condition._terms.begin() + condition._alternatives[i];
+
+		bool met = true;
+		for (; met && (term != end); ++term)
+			met = ((get(term->variable) == term->value) == term->equal);
+
+		if (met)
+			return true;
 
-		return get(varName, 0) == atoi(value.c_str());
-	} else
-		return get(conditionPart, 0) != 0;
+		term = end;
+	}
 
 	return false;
 }
 
 void Variables::evalChange(const Common::String &change) {
-	Common::StringTokenizer tokenizer(change, " ");
-
-	while (!tokenizer.empty()) {
-		Common::String changePart = tokenizer.nextToken();
-
-		evalChangePart(changePart);
-	}
+	evalChange(ChangeSet(*this, change));
 }
 
 void Variables::evalChange(const Common::List<Common::String> &change) {
@@ -200,44 +381,45 @@ void Variables::evalChange(const Common::List<Common::String> &change) {
 		evalChange(*it);
 }
 
-void Variables::evalChangePart(const Common::String &changePart) {
-	if (changePart[0] == '*')
-		set(changePart.c_str() + 1, 23);
-/*		warning("Variables::evalChangePart(): "
-				"Meaning of '*' not yet understood in change part \"%s\"",
-				changePart.c_str());*/
-	else if (changePart[0] == '+')
-		set(changePart.c_str() + 1, 24);
-/*		warning("Variables::evalChangePart(): "
-				"Meaning of '+' not yet understood in change part \"%s\"",
-				changePart.c_str());*/
-	else if (changePart[0] == '@')
-		set(changePart.c_str() + 1, 25);
-/*		warning("Variables::evalChangePart(): "
-				"Meaning of '@' not yet understood in change part \"%s\"",
-				changePart.c_str());*/
-	else if (changePart[0] == '!')
-		set(changePart.c_str() + 1, 0);
-	else if (changePart[0] == '=') {
-		Common::StringTokenizer tokenizerPart(changePart.c_str() + 1, ",");
-
-		Common::String varName = tokenizerPart.nextToken();
-		Common::String value   = tokenizerPart.nextToken();
-
-		set(varName, atoi(value.c_str()));
-	} else
-		set(changePart, 1);
+void Variables::evalChange(const ChangeSet &change) {
+	for (uint i = 0; i < change._assignments.size(); i++)
+		set(change._assignments[i].variable, change._assignments[i].value);
 }
 
 bool Variables::saveLoad(Common::Serializer &serializer, Resources &resources) {
-	SaveLoad::sync(serializer, _variables);
-	SaveLoad::sync(serializer, _localVariables);
+	// Save games store the variables by name
+	VarMap variables, localVariables;
+
+	if (serializer.isSaving()) {
+		for (uint32 i = 0; i < _names.size(); i++) {
+			if (_flags[i] & kSlotGlobal)
+				variables.setVal(_names[i], _values[i]);
+			if (_flags[i] & kSlotLocal)
+				localVariables.setVal(_names[i], _localValues[i]);
+		}
+	}
+
+	SaveLoad::sync(serializer, variables);
+	SaveLoad::sync(serializer, localVariables);
+
+	if (serializer.isLoading()) {
+		clearLocal();
+		clear();
+
+		for (VarMap::iterator it = variables.begin(); it != variables.end(); ++it)
+			setGlobal(intern(it->_key), it->_value);
+
+		for (VarMap::iterator it = localVariables.begin(); it != localVariables.end(); ++it) {
+			addLocal(it->_key);
+			set(intern(it->_key), it->_value);
+		}
+	}
 
 	return true;
 }
 
 bool Variables::loading(Resources &resources) {
-	_lastChanged = 0;
+	changed();
 
 	return true;
 }
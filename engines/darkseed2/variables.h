@@ -27,6 +27,7 @@
 #define DARKSEED2_VARIABLES_H
 
 #include "common/str.h"
+#include "common/array.h"
 #include "common/list.h"
 #include "common/hashmap.h"
 #include "common/hash-str.h"
@@ -45,6 +46,73 @@ class Resources;
 
 class Resource;
 
+class Variables;
+
+/** A condition, compiled out of the condition strings found in the game scripts. */
+class Condition {
+public:
+	Condition();
+	/** Compile a single condition string. */
+	Condition(const Variables &variables, const Common::String &condition);
+	/** Compile several condition strings, of which any single one has to be met. */
+	Condition(const Variables &variables, const Common::List<Common::String> &conditions);
+
+	/** Remove all alternatives. */
+	void clear();
+	/** Has no alternatives been added yet? */
+	bool empty() const;
+
+	/** Add a condition string as another alternative. */
+	void add(const Variables &variables, const Common::String &condition);
+
+private:
+	friend class Variables;
+
+	/** A single variable test. */
+	struct Term {
+		uint32 variable; ///< The slot of the variable tested.
+		int32  value;    ///< The value compared against.
+		bool   equal;    ///< Has the variable to be equal to or different from the value?
+	};
+
+	Common::Array<Term>   _terms;        ///< The terms of all alternatives.
+	Common::Array<uint32> _alternatives; ///< The end of each alternative in _terms.
+	Common::Array<uint32> _reads;        ///< The slots of all variables read, each only once.
+
+	/** Compile a part of a condition string into a term. */
+	static bool parseTerm(const Variables &variables, const Common::String &conditionPart, Term &term);
+};
+
+/** A variables change set, compiled out of the change strings found in the game scripts. */
+class ChangeSet {
+public:
+	ChangeSet();
+	/** Compile a change string. */
+	ChangeSet(const Variables &variables, const Common::String &change);
+
+	/** Remove all assignments. */
+	void clear();
+	/** Are there no assignments? */
+	bool empty() const;
+
+	/** Add the assignments of a change string. */
+	void add(const Variables &variables, const Common::String &change);
+
+private:
+	friend class Variables;
+
+	/** A single variable assignment. */
+	struct Assignment {
+		uint32 variable; ///< The slot of the variable assigned to.
+		uint8  value;    ///< The new value.
+	};
+
+	Common::Array<Assignment> _assignments; ///< All assignments, in order.
+
+	/** Compile a part of a change string into an assignment. */
+	static bool parseAssignment(const Variables &variables, const Common::String &changePart, Assignment &assignment);
+};
+
 class Variables : public Saveable {
 public:
 	Variables(Common::RandomSource &rnd);
@@ -63,8 +131,20 @@ public:
 	/** Get a variable's value. */
 	uint8 get(const Common::String &var) const;
 
-	/** When was a variable change last? */
-	uint32 getLastChanged() const;
+	/** Get the slot of a variable, assigning a new one if the name wasn't seen before. */
+	uint32 intern(const Common::String &var) const;
+	/** Get the name of the variable in that slot. */
+	const Common::String &getName(uint32 slot) const;
+
+	/** Set the value of the variable in that slot. */
+	void set(uint32 slot, uint8 value);
+	/** Get the value of the variable in that slot. */
+	uint8 get(uint32 slot) const;
+
+	/** How many variable changes happened so far? */
+	uint32 getChangeCount() const;
+	/** Get the change count of the last change to any variable read by that condition. */
+	uint32 getVersion(const Condition &condition) const;
 
 	/** Assign new random values to the special random variables. */
 	void reRollRandom();
@@ -80,30 +160,52 @@ public:
 	bool evalCondition(const Common::String &condition) const;
 	/** Evaluates several condition strings, like they are found in the game scripts. */
 	bool evalCondition(const Common::List<Common::String> &condition) const;
+	/** Evaluates a compiled condition. */
+	bool evalCondition(const Condition &condition) const;
 
 	/** Evaluate a change string, like they are found in the game scripts. */
 	void evalChange(const Common::String &change);
 	/** Evaluate several change strings, like they are found in the game scripts. */
 	void evalChange(const Common::List<Common::String> &change);
+	/** Evaluate a compiled change set. */
+	void evalChange(const ChangeSet &change);
 
 protected:
 	bool saveLoad(Common::Serializer &serializer, Resources &resources);
 	bool loading(Resources &resources);
 
 private:
-	typedef Common::HashMap<Common::String, uint8, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> VarMap;
+	typedef Common::HashMap<Common::String, uint8 , Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> VarMap;
+	typedef Common::HashMap<Common::String, uint32, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> SlotMap;
+
+	/** Flags of a variable slot. */
+	enum SlotFlags {
+		kSlotGlobal = 1, ///< The variable has a global value.
+		kSlotLocal  = 2  ///< The variable is local, its local value overlays the global one.
+	};
 
 	Common::RandomSource *_rnd;
 
-	VarMap _variables;      ///< The variables.
-	VarMap _localVariables; ///< The local variables.
+	// Interning a name doesn't change any value, so the slots grow even on const access
+	mutable SlotMap                      _slots;       ///< The slot of every variable name.
+	mutable Common::Array<Common::String> _names;       ///< The name of every slot.
+	mutable Common::Array<uint8>          _values;      ///< The global values.
+	mutable Common::Array<uint8>          _localValues; ///< The local values.
+	mutable Common::Array<uint8>          _flags;       ///< The SlotFlags of every slot.
+	mutable Common::Array<uint32>         _versions;    ///< The change count of every slot's last change.
+
+	Common::Array<uint32> _localSlots; ///< All slots currently declared local.
+
+	uint32 _changeCount; ///< Number of variable changes so far.
+
+	/** Remember that variables changed. */
+	void changed();
+	/** Remember that the variable in that slot changed. */
+	void changed(uint32 slot);
 
-	uint32 _lastChanged; ///< Timestamp of when a variable was changed last.
+	/** Set the global value of the variable in that slot, even if it's local. */
+	void setGlobal(uint32 slot, uint8 value);
 
-	// Evaluation helpers
-	bool evalConditionPart(const Common::String &conditionPart) const;
-	void evalChangePart(const Common::String &changePart);
-	uint8 get(const Common::String &var, uint8 def) const;
 };
 
 } // End of namespace DarkSeed2